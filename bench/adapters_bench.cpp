@@ -0,0 +1,673 @@
+#include <lib/adapters.cpp>
+#include <benchmark/benchmark.h>
+#include <array>
+#include <functional>
+#include <iomanip>
+#include <list>
+#include <map>
+#include <ranges>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+template <typename T>
+std::vector<T> make_data(size_t n) {
+    std::vector<T> data(n);
+    for (size_t i = 0; i < n; ++i) {
+        data[i] = static_cast<T>((i * 7919) % 1000);
+    }
+    return data;
+}
+
+template <typename T>
+bool keep_half(T x) {
+    return x < static_cast<T>(500);
+}
+
+template <typename T>
+T scale(T x) {
+    return x * static_cast<T>(2) + static_cast<T>(1);
+}
+
+template <typename T>
+void BM_FilterTransformSumLoop(benchmark::State& state) {
+    auto data = make_data<T>(state.range(0));
+    for (auto _: state) {
+        T sum = 0;
+        for (T x: data) {
+            if (keep_half(x)) {
+                sum += scale(x);
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename T>
+void BM_FilterTransformSumIterators(benchmark::State& state) {
+    auto data = make_data<T>(state.range(0));
+    for (auto _: state) {
+        T sum = 0;
+        for (T x: data | filter([](T x) { return keep_half(x); }) | transform([](T x) { return scale(x); })) {
+            sum += x;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename T>
+void BM_FilterTransformSumBatched(benchmark::State& state) {
+    auto data = make_data<T>(state.range(0));
+    set_simd_level(static_cast<SimdLevel>(state.range(1)));
+    for (auto _: state) {
+        T sum = data | filter([](T x) { return keep_half(x); }) | transform([](T x) { return scale(x); })
+                | reduce(T(0), [](T a, T b) { return a + b; });
+        benchmark::DoNotOptimize(sum);
+    }
+    set_simd_level(detect_simd_level());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename T>
+void BM_FilterTransformCollectLoop(benchmark::State& state) {
+    auto data = make_data<T>(state.range(0));
+    std::vector<T> out;
+    for (auto _: state) {
+        out.clear();
+        for (T x: data) {
+            if (keep_half(x)) {
+                out.push_back(scale(x));
+            }
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename T>
+void BM_FilterTransformCollectBatched(benchmark::State& state) {
+    auto data = make_data<T>(state.range(0));
+    std::vector<T> out;
+    set_simd_level(static_cast<SimdLevel>(state.range(1)));
+    for (auto _: state) {
+        out.clear();
+        data | filter([](T x) { return keep_half(x); }) | transform([](T x) { return scale(x); })
+             | for_each([&out](T x) { out.push_back(x); });
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_simd_level(detect_simd_level());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void simd_levels(benchmark::internal::Benchmark* benchmark) {
+    for (int64_t size: {1 << 10, 1 << 16, 1 << 20}) {
+        for (SimdLevel level: {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx2}) {
+            if (level <= detect_simd_level()) {
+                benchmark->Args({size, static_cast<int64_t>(level)});
+            }
+        }
+    }
+    benchmark->ArgNames({"n", "simd"});
+}
+
+BENCHMARK(BM_FilterTransformSumLoop<int>)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_FilterTransformSumIterators<int>)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_FilterTransformSumBatched<int>)->Apply(simd_levels);
+BENCHMARK(BM_FilterTransformSumLoop<float>)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_FilterTransformSumIterators<float>)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_FilterTransformSumBatched<float>)->Apply(simd_levels);
+BENCHMARK(BM_FilterTransformSumLoop<double>)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_FilterTransformSumIterators<double>)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_FilterTransformSumBatched<double>)->Apply(simd_levels);
+BENCHMARK(BM_FilterTransformCollectLoop<int>)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_FilterTransformCollectBatched<int>)->Apply(simd_levels);
+
+
+
+// One page of 10 elements at a growing offset into 1e6 ordered elements: std::set walks to the page, IndexedSet
+// jumps to it in O(log n).
+template <typename Set>
+void BM_Pagination(benchmark::State& state) {
+    constexpr int elements_count = 1'000'000;
+    constexpr size_t page_size = 10;
+    static const Set set = [] {
+        Set result;
+        for (int i = 0; i < elements_count; ++i) {
+            result.insert(i);
+        }
+        return result;
+    }();
+
+    size_t offset = static_cast<size_t>(state.range(0)) * page_size;
+    for (auto _: state) {
+        int64_t sum = 0;
+        for (int x: set | drop(offset) | take(page_size)) {
+            sum += x;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+BENCHMARK(BM_Pagination<std::set<int>>)->Arg(1)->Arg(1'000)->Arg(99'999);
+BENCHMARK(BM_Pagination<IndexedSet<int>>)->Arg(1)->Arg(1'000)->Arg(99'999);
+
+
+// The same filter | transform behind AnyView: iterating pays indirect calls per element, reduce() reads batches with
+// next_n().
+void BM_AnyViewPull(benchmark::State& state) {
+    auto data = make_data<int>(state.range(0));
+    AnyView<int> view = data | filter(keep_half<int>) | transform(scale<int>);
+    for (auto _: state) {
+        int64_t sum = 0;
+        for (int x: view) {
+            sum += x;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_AnyViewBatched(benchmark::State& state) {
+    auto data = make_data<int>(state.range(0));
+    AnyView<int> view = data | filter(keep_half<int>) | transform(scale<int>);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(view | reduce(int64_t(0), std::plus<>()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_AnyViewPull)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_AnyViewBatched)->Range(1 << 10, 1 << 20);
+
+
+// A source that grows by 1000 elements at a time, processed after each batch: re-running the pipeline is quadratic
+// in the final size, the cursor reads every element once.
+template <bool Incremental>
+void BM_Ingest(benchmark::State& state) {
+    constexpr size_t batch_size = 1000;
+    auto data = make_data<int>(state.range(0));
+    for (auto _: state) {
+        std::vector<int> source;
+        auto cursor = source | filter(keep_half<int>) | transform(scale<int>) | incremental();
+        int64_t sum = 0;
+        for (size_t from = 0; from < data.size(); from += batch_size) {
+            source.insert(source.end(), data.begin() + from, data.begin() + std::min(from + batch_size, data.size()));
+            if constexpr (Incremental) {
+                cursor.poll([&sum](int x) {
+                    sum += x;
+                });
+            } else {
+                sum = source | filter(keep_half<int>) | transform(scale<int>) | reduce(int64_t(0), std::plus<>());
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_Ingest<false>)->Range(1 << 10, 1 << 17);
+BENCHMARK(BM_Ingest<true>)->Range(1 << 10, 1 << 17);
+
+
+// Every view over vector, list, map and unordered_map, each measured four ways: a hand-written loop, std::views,
+// pulling through the adapters' iterators and pushing through them with reduce(). Names are
+// View/container/variant/n, and PenaltyReporter prints each adapter variant relative to the loop and to std::views.
+// For results comparable across commits, run with --benchmark_out=<file> --benchmark_out_format=json.
+template <typename T>
+constexpr bool is_pair = false;
+
+template <typename First, typename Second>
+constexpr bool is_pair<std::pair<First, Second>> = true;
+
+int key_of(int x) {
+    return x;
+}
+
+template <typename First, typename Second>
+int key_of(const std::pair<First, Second>& element) {
+    return element.first;
+}
+
+int64_t mix(int x) {
+    return (static_cast<int64_t>(x) * 7919) % 100;
+}
+
+template <typename Container>
+Container make_container(size_t n) {
+    Container container;
+    for (size_t i = 0; i < n; ++i) {
+        int key = static_cast<int>(i);
+        if constexpr (requires { typename Container::mapped_type; }) {
+            container.emplace(key, static_cast<int>(mix(key)));
+        } else {
+            container.insert(container.end(), key);
+        }
+    }
+    return container;
+}
+
+template <typename Container>
+constexpr bool is_associative = requires { typename Container::mapped_type; };
+
+template <typename Container>
+constexpr bool is_bidirectional =
+        std::derived_from<typename std::iterator_traits<typename Container::const_iterator>::iterator_category,
+                          std::bidirectional_iterator_tag>;
+
+// FlatMap iterators yield pairs of references, which std::ranges does not accept as the reference of a pair
+// iterator, so std::views walk its two arrays by index instead.
+template <typename Container>
+auto std_range(const Container& container) {
+    if constexpr (is_flat_map<Container>) {
+        return std::views::iota(size_t(0), container.size()) | std::views::transform([&container](size_t i) {
+            return std::pair(container.keys()[i], container.values()[i]);
+        });
+    } else {
+        return std::views::all(container);
+    }
+}
+
+enum class Variant {
+    HandLoop,
+    StdViews,
+    Adapters,
+    AdaptersPush,
+};
+
+const char* variant_name(Variant variant) {
+    switch (variant) {
+        case Variant::HandLoop:
+            return "HandLoop";
+        case Variant::StdViews:
+            return "StdViews";
+        case Variant::Adapters:
+            return "Adapters";
+        case Variant::AdaptersPush:
+            return "AdaptersPush";
+    }
+    return "";
+}
+
+template <typename Range>
+int64_t sum_pulled(Range&& range) {
+    int64_t sum = 0;
+    for (auto&& x: range) {
+        sum += x;
+    }
+    return sum;
+}
+
+template <typename Pipeline>
+int64_t sum_pushed(const Pipeline& pipeline) {
+    return pipeline | reduce(int64_t(0), std::plus<>());
+}
+
+auto scale_key = [](const auto& element) {
+    return static_cast<int64_t>(key_of(element)) * 3 + 1;
+};
+
+auto project_key = [](const auto& element) {
+    return key_of(element);
+};
+
+struct TransformCase {
+    static constexpr const char* name = "Transform";
+
+    template <typename Container>
+    static constexpr bool supports = true;
+
+    template <typename Container>
+    static int64_t run(const Container& container, Variant variant) {
+        switch (variant) {
+            case Variant::HandLoop: {
+                int64_t sum = 0;
+                for (const auto& element: container) {
+                    sum += scale_key(element);
+                }
+                return sum;
+            }
+            case Variant::StdViews:
+                return sum_pulled(std_range(container) | std::views::transform(scale_key));
+            case Variant::Adapters:
+                return sum_pulled(container | transform(scale_key));
+            case Variant::AdaptersPush:
+                return sum_pushed(container | transform(scale_key));
+        }
+        return 0;
+    }
+};
+
+template <int Percent>
+struct FilterCase {
+    static constexpr const char* name = Percent == 1 ? "Filter1" : Percent == 50 ? "Filter50" : "Filter99";
+
+    template <typename Container>
+    static constexpr bool supports = true;
+
+    static constexpr auto selected = [](const auto& element) {
+        return mix(key_of(element)) < Percent;
+    };
+
+    template <typename Container>
+    static int64_t run(const Container& container, Variant variant) {
+        switch (variant) {
+            case Variant::HandLoop: {
+                int64_t sum = 0;
+                for (const auto& element: container) {
+                    if (selected(element)) {
+                        sum += key_of(element);
+                    }
+                }
+                return sum;
+            }
+            case Variant::StdViews: {
+                auto view = std_range(container) | std::views::filter(selected) | std::views::transform(project_key);
+                return sum_pulled(view);
+            }
+            case Variant::Adapters:
+                return sum_pulled(container | filter(selected) | transform(project_key));
+            case Variant::AdaptersPush:
+                return sum_pushed(container | filter(selected) | transform(project_key));
+        }
+        return 0;
+    }
+};
+
+struct TakeCase {
+    static constexpr const char* name = "Take";
+
+    template <typename Container>
+    static constexpr bool supports = true;
+
+    template <typename Container>
+    static int64_t run(const Container& container, Variant variant) {
+        size_t n = container.size() / 2;
+        switch (variant) {
+            case Variant::HandLoop: {
+                int64_t sum = 0;
+                auto it = container.begin();
+                for (size_t i = 0; i < n; ++i, ++it) {
+                    sum += key_of(*it);
+                }
+                return sum;
+            }
+            case Variant::StdViews:
+                return sum_pulled(std_range(container) | std::views::take(n) | std::views::transform(project_key));
+            case Variant::Adapters:
+                return sum_pulled(container | take(n) | transform(project_key));
+            case Variant::AdaptersPush:
+                return sum_pushed(container | take(n) | transform(project_key));
+        }
+        return 0;
+    }
+};
+
+struct DropCase {
+    static constexpr const char* name = "Drop";
+
+    template <typename Container>
+    static constexpr bool supports = true;
+
+    template <typename Container>
+    static int64_t run(const Container& container, Variant variant) {
+        size_t n = container.size() / 2;
+        switch (variant) {
+            case Variant::HandLoop: {
+                int64_t sum = 0;
+                for (auto it = std::next(container.begin(), n); it != container.end(); ++it) {
+                    sum += key_of(*it);
+                }
+                return sum;
+            }
+            case Variant::StdViews:
+                return sum_pulled(std_range(container) | std::views::drop(n) | std::views::transform(project_key));
+            case Variant::Adapters:
+                return sum_pulled(container | drop(n) | transform(project_key));
+            case Variant::AdaptersPush:
+                return sum_pushed(container | drop(n) | transform(project_key));
+        }
+        return 0;
+    }
+};
+
+struct ReverseCase {
+    static constexpr const char* name = "Reverse";
+
+    template <typename Container>
+    static constexpr bool supports = is_bidirectional<Container>;
+
+    template <typename Container>
+    static int64_t run(const Container& container, Variant variant) {
+        switch (variant) {
+            case Variant::HandLoop: {
+                int64_t sum = 0;
+                for (auto it = container.rbegin(); it != container.rend(); ++it) {
+                    sum += key_of(*it);
+                }
+                return sum;
+            }
+            case Variant::StdViews:
+                return sum_pulled(std_range(container) | std::views::reverse | std::views::transform(project_key));
+            case Variant::Adapters:
+                return sum_pulled(container | reverse() | transform(project_key));
+            case Variant::AdaptersPush:
+                return sum_pushed(container | reverse() | transform(project_key));
+        }
+        return 0;
+    }
+};
+
+template <bool IsKeys>
+struct KeysValuesCase {
+    static constexpr const char* name = IsKeys ? "Keys" : "Values";
+
+    template <typename Container>
+    static constexpr bool supports = is_associative<Container>;
+
+    template <typename Container>
+    static int64_t run(const Container& container, Variant variant) {
+        switch (variant) {
+            case Variant::HandLoop: {
+                int64_t sum = 0;
+                for (const auto& element: container) {
+                    sum += IsKeys ? element.first : element.second;
+                }
+                return sum;
+            }
+            case Variant::StdViews:
+                if constexpr (IsKeys) {
+                    return sum_pulled(std_range(container) | std::views::keys);
+                } else {
+                    return sum_pulled(std_range(container) | std::views::values);
+                }
+            case Variant::Adapters:
+                if constexpr (IsKeys) {
+                    return sum_pulled(container | keys());
+                } else {
+                    return sum_pulled(container | values());
+                }
+            case Variant::AdaptersPush:
+                if constexpr (IsKeys) {
+                    return sum_pushed(container | keys());
+                } else {
+                    return sum_pushed(container | values());
+                }
+        }
+        return 0;
+    }
+};
+
+// The chain of UltraMapTestStick: drop | take | filter | reverse x3 | transform, ending in keys() over maps.
+struct DeepStackCase {
+    static constexpr const char* name = "DeepStack";
+
+    template <typename Container>
+    static constexpr bool supports = is_bidirectional<Container>;
+
+    static constexpr auto even_key = [](const auto& element) {
+        return key_of(element) % 2 == 0;
+    };
+
+    static constexpr auto double_key = [](const auto& element) {
+        if constexpr (is_pair<std::remove_cvref_t<decltype(element)>>) {
+            return std::make_pair(element.first * 2, element.second);
+        } else {
+            return element * 2;
+        }
+    };
+
+    template <typename Container>
+    static int64_t run(const Container& container, Variant variant) {
+        size_t n = container.size() < 3 ? 0 : container.size() - 3;
+        switch (variant) {
+            case Variant::HandLoop: {
+                int64_t sum = 0;
+                auto first = std::next(container.begin(), std::min<size_t>(2, container.size()));
+                auto last = std::next(first, n);
+                while (last != first) {
+                    --last;
+                    if (even_key(*last)) {
+                        sum += key_of(double_key(*last));
+                    }
+                }
+                return sum;
+            }
+            case Variant::StdViews: {
+                auto view = std_range(container) | std::views::drop(2) | std::views::take(n) | std::views::filter(even_key)
+                            | std::views::reverse | std::views::reverse | std::views::reverse
+                            | std::views::transform(double_key);
+                if constexpr (is_associative<Container>) {
+                    return sum_pulled(view | std::views::keys);
+                } else {
+                    return sum_pulled(view);
+                }
+            }
+            case Variant::Adapters:
+            case Variant::AdaptersPush: {
+                auto view = container | drop(2) | take(n) | filter(even_key) | reverse() | reverse() | reverse()
+                            | transform(double_key);
+                if constexpr (is_associative<Container>) {
+                    return variant == Variant::Adapters ? sum_pulled(view | keys()) : sum_pushed(view | keys());
+                } else {
+                    return variant == Variant::Adapters ? sum_pulled(view) : sum_pushed(view);
+                }
+            }
+        }
+        return 0;
+    }
+};
+
+template <typename Case, typename Container>
+void BM_View(benchmark::State& state, Variant variant) {
+    auto container = make_container<Container>(state.range(0));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(Case::run(container, variant));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Case, typename Container>
+void register_view_benchmark(const std::string& container_name) {
+    if constexpr (Case::template supports<Container>) {
+        for (Variant variant: {Variant::HandLoop, Variant::StdViews, Variant::Adapters, Variant::AdaptersPush}) {
+            std::string name = std::string(Case::name) + "/" + container_name + "/" + variant_name(variant);
+            benchmark::RegisterBenchmark(name.c_str(), BM_View<Case, Container>, variant)
+                    ->RangeMultiplier(10)
+                    ->Range(1'000, 10'000'000);
+        }
+    }
+}
+
+template <typename Container>
+void register_container_benchmarks(const std::string& container_name) {
+    register_view_benchmark<TransformCase, Container>(container_name);
+    register_view_benchmark<FilterCase<1>, Container>(container_name);
+    register_view_benchmark<FilterCase<50>, Container>(container_name);
+    register_view_benchmark<FilterCase<99>, Container>(container_name);
+    register_view_benchmark<TakeCase, Container>(container_name);
+    register_view_benchmark<DropCase, Container>(container_name);
+    register_view_benchmark<ReverseCase, Container>(container_name);
+    register_view_benchmark<KeysValuesCase<true>, Container>(container_name);
+    register_view_benchmark<KeysValuesCase<false>, Container>(container_name);
+    register_view_benchmark<DeepStackCase, Container>(container_name);
+}
+
+// Console output followed by the abstraction penalty: time of each adapter variant divided by the time of the hand
+// loop and of std::views for the same view, container and size.
+class PenaltyReporter : public benchmark::ConsoleReporter {
+public:
+    void ReportRuns(const std::vector<Run>& reports) override {
+        ConsoleReporter::ReportRuns(reports);
+        for (const auto& run: reports) {
+            if (run.run_type != Run::RT_Iteration) {
+                continue;
+            }
+            std::string name = run.benchmark_name();
+            for (Variant variant: {Variant::HandLoop, Variant::StdViews, Variant::Adapters, Variant::AdaptersPush}) {
+                std::string marker = std::string("/") + variant_name(variant) + "/";
+                size_t position = name.find(marker);
+                if (position != std::string::npos) {
+                    std::string group = name.substr(0, position) + name.substr(position + marker.size() - 1);
+                    times_[group][static_cast<size_t>(variant)] = run.GetAdjustedRealTime();
+                    if (std::find(groups_.begin(), groups_.end(), group) == groups_.end()) {
+                        groups_.push_back(group);
+                    }
+                }
+            }
+        }
+    }
+
+    void Finalize() override {
+        ConsoleReporter::Finalize();
+        if (groups_.empty()) {
+            return;
+        }
+
+        auto& out = GetOutputStream();
+        out << "\nAbstraction penalty (time / time of the baseline)\n";
+        out << std::left << std::setw(40) << "view/container/n" << std::right << std::setw(14) << "pull/loop"
+            << std::setw(14) << "push/loop" << std::setw(14) << "pull/views" << std::setw(14) << "push/views"
+            << "\n";
+        for (const auto& group: groups_) {
+            const auto& times = times_[group];
+            out << std::left << std::setw(40) << group << std::right << std::fixed << std::setprecision(2);
+            for (auto [variant, baseline]: {std::pair(Variant::Adapters, Variant::HandLoop),
+                                            std::pair(Variant::AdaptersPush, Variant::HandLoop),
+                                            std::pair(Variant::Adapters, Variant::StdViews),
+                                            std::pair(Variant::AdaptersPush, Variant::StdViews)}) {
+                double time = times[static_cast<size_t>(variant)];
+                double baseline_time = times[static_cast<size_t>(baseline)];
+                if (time > 0 && baseline_time > 0) {
+                    out << std::setw(14) << time / baseline_time;
+                } else {
+                    out << std::setw(14) << "-";
+                }
+            }
+            out << "\n";
+        }
+    }
+
+private:
+    std::vector<std::string> groups_;
+    std::map<std::string, std::array<double, 4>> times_;
+};
+
+int main(int argc, char** argv) {
+    register_container_benchmarks<std::vector<int>>("vector");
+    register_container_benchmarks<std::list<int>>("list");
+    register_container_benchmarks<std::map<int, int>>("map");
+    register_container_benchmarks<std::unordered_map<int, int>>("unordered_map");
+    register_container_benchmarks<FlatMap<int, int>>("flat_map");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    PenaltyReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+    return 0;
+}
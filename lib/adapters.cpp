@@ -1,25 +1,354 @@
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <istream>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "simd.cpp"
+#include "instrumentation.cpp"
+#include "thread_pool.cpp"
+#include "mapped_file.cpp"
+#include "flat_map.cpp"
+#include "order_statistic_tree.cpp"
+
+// end() may return a sentinel of another type than begin(), as long as the two compare.
+template <typename T>
+concept IsContainer = requires(const T& container) {
+    { container.begin() != container.end() } -> std::convertible_to<bool>;
+    requires std::derived_from<typename T::const_iterator::iterator_category, std::input_iterator_tag>;
+};
+
+template <typename Container>
+using SentinelOf = decltype(std::declval<const Container&>().end());
+
+template <typename Container>
+concept IsCommon = std::same_as<typename Container::const_iterator, SentinelOf<Container>>;
+
+// End of a view over a container that ends in a sentinel: it wraps the container's sentinel,
+// and the view's iterators compare their underlying position against it.
+template <typename Sentinel>
+class ViewSentinel {
+public:
+    ViewSentinel() = default;
+
+    explicit ViewSentinel(Sentinel end): end_(std::move(end)) {}
+
+    const Sentinel& base() const {
+        return end_;
+    }
+
+private:
+    Sentinel end_;
+};
+
+template <typename Iterator>
+concept IsSeekable = requires(Iterator a, Iterator b, std::ptrdiff_t n) {
+    a += n;
+    { b - a } -> std::convertible_to<std::ptrdiff_t>;
+};
+
+template <typename Container>
+concept IsSized = requires(const Container& container) {
+    { container.size() } -> std::convertible_to<size_t>;
+};
+
+// Over a base it cannot seek in, DropView finds its boundary with this once and caches it,
+// so the length of such a container must not change while the view is in use.
+template <typename Iterator, typename Sentinel>
+Iterator advance_bounded(Iterator it, size_t n, Sentinel bound) {
+    if constexpr (IsSeekable<Iterator> && std::same_as<Iterator, Sentinel>) {
+        auto left = static_cast<size_t>(bound - it);
+        it += static_cast<std::ptrdiff_t>(std::min(n, left));
+        return it;
+    } else if constexpr (IsSeekable<Iterator> && std::same_as<Sentinel, std::unreachable_sentinel_t>) {
+        it += static_cast<std::ptrdiff_t>(std::min<size_t>(n, std::numeric_limits<std::ptrdiff_t>::max()));
+        return it;
+    } else {
+        for (size_t i = 0; i < n && it != bound; ++i) {
+            ++it;
+        }
+        return it;
+    }
+}
+
+// Internal iteration: every element is passed to the consumer until it returns false.
+// Views override this with push_each(), which composes their stage into the consumer instead of going through iterators.
+template <typename Container, typename Consumer>
+bool push_elements(const Container& container, Consumer&& consumer) {
+    if constexpr (requires { container.push_each(consumer); }) {
+        return container.push_each(consumer);
+    } else {
+        auto end = container.end();
+        for (auto it = container.begin(); it != end; ++it) {
+            if (!consumer(*it)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+// Parallel terminals cut a pipeline into slices of its source range. Element-wise stages (filter, transform, keys,
+// values) pass a slice through to their container with push_slice(), and random-access containers are cut with
+// iterator arithmetic, so a filter over a vector can be split although the filter itself is not random access.
+template <typename Container>
+concept IsSliceable = requires(const Container& container) {
+    container.slice_extent();
+} || (std::random_access_iterator<typename Container::const_iterator> && IsCommon<Container>);
+
+template <typename Container>
+size_t slice_extent_of(const Container& container) {
+    if constexpr (requires { container.slice_extent(); }) {
+        return container.slice_extent();
+    } else {
+        return static_cast<size_t>(container.end() - container.begin());
+    }
+}
+
+template <typename Container, typename Consumer>
+bool push_slice_elements(const Container& container, size_t from, size_t to, Consumer&& consumer) {
+    if constexpr (requires { container.push_slice(from, to, consumer); }) {
+        return container.push_slice(from, to, consumer);
+    } else {
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        auto first = container.begin();
+        auto last = first + static_cast<difference_type>(to);
+        for (auto it = first + static_cast<difference_type>(from); it != last; ++it) {
+            if (!consumer(*it)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+template <typename T>
+class NonPropagatingCache : public std::optional<T> {
+public:
+    NonPropagatingCache() = default;
+
+    NonPropagatingCache(const NonPropagatingCache&) noexcept: std::optional<T>() {}
+
+    NonPropagatingCache(NonPropagatingCache&& other) noexcept {
+        other.reset();
+    }
+
+    NonPropagatingCache& operator=(const NonPropagatingCache& other) noexcept {
+        if (this != &other) {
+            this->reset();
+        }
+        return *this;
+    }
+
+    NonPropagatingCache& operator=(NonPropagatingCache&& other) noexcept {
+        this->reset();
+        other.reset();
+        return *this;
+    }
+
+    using std::optional<T>::operator=;
+};
+
+template <typename Container>
+class OwningView {
+public:
+    static_assert(IsContainer<Container>);
+
+    explicit OwningView(Container&& container): container_(std::move(container)) {}
+
+    const Container& base() const {
+        return container_;
+    }
+
+    auto begin() const {
+        return container_.begin();
+    }
+
+    auto end() const {
+        return container_.end();
+    }
+
+    size_t size() const requires IsSized<Container> {
+        return container_.size();
+    }
+
+    bool empty() const requires IsSized<Container> {
+        return container_.empty();
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        return push_elements(container_, consumer);
+    }
+
+    size_t slice_extent() const requires IsSliceable<Container> {
+        return slice_extent_of(container_);
+    }
+
+    template <typename Consumer>
+    bool push_slice(size_t from, size_t to, Consumer&& consumer) const requires IsSliceable<Container> {
+        return push_slice_elements(container_, from, to, consumer);
+    }
+
+private:
+    Container container_;
+
+public:
+    using const_iterator = Container::const_iterator;
+};
+
+template <typename T>
+constexpr bool is_owning_view = false;
+
+template <typename Container>
+constexpr bool is_owning_view<OwningView<Container>> = true;
+
+// Views reference containers passed as lvalues. Rvalues are moved into an OwningView, which the view keeps by value.
+// Cached positions are not carried over when a view is copied or moved, since they may point into the old storage.
+template <typename Container>
+using StoredContainer = std::conditional_t<is_owning_view<Container>, Container, Container&>;
+
+template <typename Container>
+using ViewedContainer = std::conditional_t<
+        std::is_lvalue_reference_v<Container>, std::remove_reference_t<Container>,
+        std::conditional_t<is_owning_view<std::remove_cvref_t<Container>>, std::remove_cvref_t<Container>,
+                           OwningView<std::remove_cvref_t<Container>>>>;
+
+template <typename Container>
+decltype(auto) as_stored(Container&& container) {
+    if constexpr (std::is_lvalue_reference_v<Container>) {
+        return (container);
+    } else if constexpr (is_owning_view<std::remove_cvref_t<Container>>) {
+        return std::remove_cvref_t<Container>(std::move(container));
+    } else {
+        return OwningView<std::remove_cvref_t<Container>>(std::move(container));
+    }
+}
+
+// Refers to a container without owning it; stacks that collapse down to their container return one of these.
+template <typename Container>
+class RefView {
+public:
+    static_assert(IsContainer<Container>);
+
+    explicit RefView(Container& container): container_(&container) {}
+
+    auto begin() const {
+        return container_->begin();
+    }
+
+    auto end() const {
+        return container_->end();
+    }
+
+    size_t size() const requires IsSized<Container> {
+        return container_->size();
+    }
+
+    bool empty() const requires IsSized<Container> {
+        return container_->empty();
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        return push_elements(*container_, consumer);
+    }
+
+    size_t slice_extent() const requires IsSliceable<Container> {
+        return slice_extent_of(*container_);
+    }
+
+    template <typename Consumer>
+    bool push_slice(size_t from, size_t to, Consumer&& consumer) const requires IsSliceable<Container> {
+        return push_slice_elements(*container_, from, to, consumer);
+    }
+
+private:
+    Container* container_;
+
+public:
+    using const_iterator = Container::const_iterator;
+};
 
+// A contiguous range the library can stack views on: std::span has no const_iterator before C++23.
 template <typename T>
-concept IsContainer = requires(T container) {
-    container.begin();
-    container.end();
-    requires std::derived_from<typename T::const_iterator::iterator_category, std::forward_iterator_tag>;
+class SpanView {
+public:
+    explicit SpanView(std::span<T> span): span_(span) {}
+
+    auto begin() const {
+        return span_.begin();
+    }
+
+    auto end() const {
+        return span_.end();
+    }
+
+    T* data() const {
+        return span_.data();
+    }
+
+    size_t size() const {
+        return span_.size();
+    }
+
+    bool empty() const {
+        return span_.empty();
+    }
+
+private:
+    std::span<T> span_;
+
+public:
+    using const_iterator = std::span<T>::iterator;
 };
 
+// When two stacked views are replaced by one, the new view takes over the container of the inner one:
+// an owned container is moved out of a temporary view and referenced in a named one.
+template <typename View>
+using RebasedContainer = std::conditional_t<
+        is_owning_view<typename std::remove_cvref_t<View>::base_type> && std::is_lvalue_reference_v<View>,
+        const typename std::remove_cvref_t<View>::base_type, typename std::remove_cvref_t<View>::base_type>;
+
 struct KeysViewParam {};
 struct ValuesViewParam {};
 struct ReverseViewParam {};
+struct Cache1ViewParam {};
+
+template <typename Key>
+struct KeyRangeViewParam {
+    Key from;
+    std::optional<Key> to;
+};
+
+template <typename Predicate>
+struct TakeWhileKeyViewParam {
+    Predicate predicate;
+};
 
 template<typename FunctionType>
 struct TransformViewParam {
-    TransformViewParam(FunctionType function): function(function) {}
+    TransformViewParam(FunctionType function): function(std::move(function)) {}
     FunctionType function;
 };
 
 template<typename ConditionType>
 struct FilterViewParam {
-    FilterViewParam(ConditionType function): condition(function) {}
+    FilterViewParam(ConditionType function): condition(std::move(function)) {}
     ConditionType condition;
 };
 
@@ -33,6 +362,24 @@ struct DropViewParam {
     size_t n;
 };
 
+template <typename FunctionType>
+struct AsyncTransformViewParam {
+    AsyncTransformViewParam(FunctionType function, size_t workers, size_t window):
+            function(std::move(function)), workers(workers), window(window) {}
+    FunctionType function;
+    size_t workers;
+    size_t window;
+};
+
+struct ChunkViewParam {
+    ChunkViewParam(size_t n): n(n) {
+        if (n == 0) {
+            throw std::invalid_argument("chunk size must be positive");
+        }
+    }
+    size_t n;
+};
+
 
 
 template <typename AssociativeContainer>
@@ -40,19 +387,32 @@ class KeysView {
 public:
     static_assert(IsContainer<AssociativeContainer>);
 
-    explicit KeysView(AssociativeContainer& container): container_(container) {}
+    explicit KeysView(StoredContainer<AssociativeContainer> container):
+            container_(std::forward<StoredContainer<AssociativeContainer>>(container)),
+            probe_(make_stage_probe<KeysView>("keys")) {}
 
     class iterator {
     public:
         using iterator_category = AssociativeContainer::const_iterator::iterator_category;
+        using difference_type = std::iter_difference_t<typename AssociativeContainer::const_iterator>;
+        using value_type = std::remove_cvref_t<decltype(std::declval<std::iter_reference_t<typename AssociativeContainer::const_iterator>>().first)>;
+        using reference = std::conditional_t<
+                std::is_lvalue_reference_v<std::iter_reference_t<typename AssociativeContainer::const_iterator>>,
+                decltype((std::declval<std::iter_reference_t<typename AssociativeContainer::const_iterator>>().first)),
+                value_type>;
+
+        iterator() = default;
 
-        explicit iterator(AssociativeContainer::const_iterator it): iterator_(it) {}
+        explicit iterator(AssociativeContainer::const_iterator it, const StageProbe<KeysView>& probe = {}):
+                iterator_(it), probe_(probe) {}
 
-        auto operator*() const {
+        reference operator*() const {
+            probe_.dereference();
             return (*iterator_).first;
         }
 
         iterator& operator++() {
+            probe_.increment();
             ++iterator_;
             return *this;
         }
@@ -64,6 +424,7 @@ public:
         }
 
         iterator& operator--() {
+            probe_.decrement();
             --iterator_;
             return *this;
         }
@@ -74,6 +435,42 @@ public:
             return temp;
         }
 
+        iterator& operator+=(difference_type n) requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            probe_.seek(n);
+            iterator_ += n;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            probe_.seek(-n);
+            iterator_ += -n;
+            return *this;
+        }
+
+        iterator operator+(difference_type n) const requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend iterator operator+(difference_type n, const iterator& it) requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            return it + n;
+        }
+
+        iterator operator-(difference_type n) const requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const iterator& other) const requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            return iterator_ - other.iterator_;
+        }
+
+        reference operator[](difference_type n) const requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            return *(*this + n);
+        }
+
         bool operator==(const iterator& other) const {
             return iterator_ == other.iterator_;
         }
@@ -82,37 +479,82 @@ public:
             return !(*this == other);
         }
 
+        friend bool operator==(const iterator& it, const ViewSentinel<SentinelOf<AssociativeContainer>>& end) {
+            return it.iterator_ == end.base();
+        }
+
+        auto operator<=>(const iterator& other) const requires std::three_way_comparable<typename AssociativeContainer::const_iterator> {
+            return iterator_ <=> other.iterator_;
+        }
+
     private:
         AssociativeContainer::const_iterator iterator_;
+        [[no_unique_address]] StageProbe<KeysView> probe_;
     };
 
     iterator begin() const {
-        return iterator(container_.begin());
+        return iterator(container_.begin(), probe_);
     }
 
-    iterator end() const {
-        return iterator(container_.end());
+    auto end() const {
+        if constexpr (IsCommon<AssociativeContainer>) {
+            return iterator(container_.end(), probe_);
+        } else {
+            return ViewSentinel<SentinelOf<AssociativeContainer>>(container_.end());
+        }
+    }
+
+    size_t size() const requires IsSized<AssociativeContainer> {
+        return container_.size();
+    }
+
+    bool empty() const requires IsSized<AssociativeContainer> {
+        return size() == 0;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        return push_elements(container_, [&consumer](auto&& element) {
+            return consumer(element.first);
+        });
+    }
+
+    size_t slice_extent() const requires IsSliceable<AssociativeContainer> {
+        return slice_extent_of(container_);
+    }
+
+    template <typename Consumer>
+    bool push_slice(size_t from, size_t to, Consumer&& consumer) const requires IsSliceable<AssociativeContainer> {
+        return push_slice_elements(container_, from, to, [&consumer](auto&& element) {
+            return consumer(element.first);
+        });
     }
 
 private:
-    AssociativeContainer& container_;
+    StoredContainer<AssociativeContainer> container_;
+    [[no_unique_address]] StageProbe<KeysView> probe_;
 
 public:
     using const_iterator = iterator;
 };
 
 template <typename AssociativeContainer>
-KeysView<AssociativeContainer> keys(AssociativeContainer& container) {
-    return KeysView<AssociativeContainer>(container);
+auto keys(AssociativeContainer& container) {
+    return container | KeysViewParam();
 }
 
 KeysViewParam keys() {
     return {};
 }
 
+// The keys of a named FlatMap are already a contiguous array, so the view is just a span over it.
 template <typename Container>
 auto operator|(Container&& container, KeysViewParam keys_view_param) {
-    return KeysView<std::remove_reference_t<Container>>(container);
+    if constexpr (is_flat_map<std::remove_cvref_t<Container>> && std::is_lvalue_reference_v<Container>) {
+        return SpanView(container.keys());
+    } else {
+        return KeysView<ViewedContainer<Container>>(as_stored(std::forward<Container>(container)));
+    }
 }
 
 
@@ -122,19 +564,32 @@ class ValueView {
 public:
     static_assert(IsContainer<AssociativeContainer>);
 
-    explicit ValueView(AssociativeContainer& container): container_(container) {    }
+    explicit ValueView(StoredContainer<AssociativeContainer> container):
+            container_(std::forward<StoredContainer<AssociativeContainer>>(container)),
+            probe_(make_stage_probe<ValueView>("values")) {}
 
     class iterator {
     public:
         using iterator_category = AssociativeContainer::const_iterator::iterator_category;
+        using difference_type = std::iter_difference_t<typename AssociativeContainer::const_iterator>;
+        using value_type = std::remove_cvref_t<decltype(std::declval<std::iter_reference_t<typename AssociativeContainer::const_iterator>>().second)>;
+        using reference = std::conditional_t<
+                std::is_lvalue_reference_v<std::iter_reference_t<typename AssociativeContainer::const_iterator>>,
+                decltype((std::declval<std::iter_reference_t<typename AssociativeContainer::const_iterator>>().second)),
+                value_type>;
 
-        explicit iterator(AssociativeContainer::const_iterator it): iterator_(it) {}
+        iterator() = default;
 
-        auto operator*() const {
+        explicit iterator(AssociativeContainer::const_iterator it, const StageProbe<ValueView>& probe = {}):
+                iterator_(it), probe_(probe) {}
+
+        reference operator*() const {
+            probe_.dereference();
             return (*iterator_).second;
         }
 
         iterator& operator++() {
+            probe_.increment();
             ++iterator_;
             return *this;
         }
@@ -146,6 +601,7 @@ public:
         }
 
         iterator& operator--() {
+            probe_.decrement();
             --iterator_;
             return *this;
         }
@@ -156,6 +612,42 @@ public:
             return temp;
         }
 
+        iterator& operator+=(difference_type n) requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            probe_.seek(n);
+            iterator_ += n;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            probe_.seek(-n);
+            iterator_ += -n;
+            return *this;
+        }
+
+        iterator operator+(difference_type n) const requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend iterator operator+(difference_type n, const iterator& it) requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            return it + n;
+        }
+
+        iterator operator-(difference_type n) const requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const iterator& other) const requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            return iterator_ - other.iterator_;
+        }
+
+        reference operator[](difference_type n) const requires IsSeekable<typename AssociativeContainer::const_iterator> {
+            return *(*this + n);
+        }
+
         bool operator==(const iterator& other) const {
             return iterator_ == other.iterator_;
         }
@@ -164,28 +656,68 @@ public:
             return !(*this == other);
         }
 
+        friend bool operator==(const iterator& it, const ViewSentinel<SentinelOf<AssociativeContainer>>& end) {
+            return it.iterator_ == end.base();
+        }
+
+        auto operator<=>(const iterator& other) const requires std::three_way_comparable<typename AssociativeContainer::const_iterator> {
+            return iterator_ <=> other.iterator_;
+        }
+
     private:
         AssociativeContainer::const_iterator iterator_;
+        [[no_unique_address]] StageProbe<ValueView> probe_;
     };
 
     iterator begin() const {
-        return iterator(container_.begin());
+        return iterator(container_.begin(), probe_);
     }
 
-    iterator end() const {
-        return iterator(container_.end());
+    auto end() const {
+        if constexpr (IsCommon<AssociativeContainer>) {
+            return iterator(container_.end(), probe_);
+        } else {
+            return ViewSentinel<SentinelOf<AssociativeContainer>>(container_.end());
+        }
+    }
+
+    size_t size() const requires IsSized<AssociativeContainer> {
+        return container_.size();
+    }
+
+    bool empty() const requires IsSized<AssociativeContainer> {
+        return size() == 0;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        return push_elements(container_, [&consumer](auto&& element) {
+            return consumer(element.second);
+        });
+    }
+
+    size_t slice_extent() const requires IsSliceable<AssociativeContainer> {
+        return slice_extent_of(container_);
+    }
+
+    template <typename Consumer>
+    bool push_slice(size_t from, size_t to, Consumer&& consumer) const requires IsSliceable<AssociativeContainer> {
+        return push_slice_elements(container_, from, to, [&consumer](auto&& element) {
+            return consumer(element.second);
+        });
     }
 
 private:
-    AssociativeContainer& container_;
+    StoredContainer<AssociativeContainer> container_;
+    [[no_unique_address]] StageProbe<ValueView> probe_;
 
 public:
     using const_iterator = iterator;
 };
 
 template <typename AssociativeContainer>
-ValueView<AssociativeContainer> values(AssociativeContainer& container) {
-    return ValueView<AssociativeContainer>(container);
+auto values(AssociativeContainer& container) {
+    return container | ValuesViewParam();
 }
 
 ValuesViewParam values() {
@@ -194,7 +726,11 @@ ValuesViewParam values() {
 
 template <typename Container>
 auto operator|(Container&& container, ValuesViewParam keys_view_param) {
-    return ValueView<std::remove_reference_t<Container>>(container);
+    if constexpr (is_flat_map<std::remove_cvref_t<Container>> && std::is_lvalue_reference_v<Container>) {
+        return SpanView(std::as_const(container).values());
+    } else {
+        return ValueView<ViewedContainer<Container>>(as_stored(std::forward<Container>(container)));
+    }
 }
 
 
@@ -204,39 +740,54 @@ class TakeView {
 public:
     static_assert(IsContainer<Container>);
 
-    explicit TakeView(Container& container, size_t to_take_n): container_(container), to_take_n_(to_take_n) {}
-
-    class iterator {
-    public:
-        using iterator_category = Container::const_iterator::iterator_category;
+    explicit TakeView(StoredContainer<Container> container, size_t to_take_n):
+            container_(std::forward<StoredContainer<Container>>(container)), to_take_n_(to_take_n),
+            probe_(make_stage_probe<TakeView>("take")) {}
 
-        explicit iterator(Container::const_iterator it, size_t to_take_n, Container::const_iterator begin_iterator,
-                          Container::const_iterator end_iterator):
-                            iterator_(it), end_iterator_(end_iterator)  {
-            typename Container::const_iterator new_end = begin_iterator;
-            for (size_t i = 0; i < to_take_n; ++i) {
-                if (new_end == end_iterator) {
-                    break;
-                }
-                ++new_end;
-            }
+    // A seekable container gets its end in O(1), so the view keeps plain positions. Over any other container the
+    // iterator counts down the elements left, and end() is a sentinel reached when either the count or the container
+    // runs out; nothing is walked up front, which also makes take() usable on sources without an end.
+    static constexpr bool is_counted = !(IsSeekable<typename Container::const_iterator> && IsCommon<Container>);
 
-            if (it == end_iterator) {
-                iterator_ = new_end;
-            }
-            end_iterator_ = new_end;
+    class iterator {
+        struct Uncounted {};
 
-            if (to_take_n == 0) {
-                iterator_ = end_iterator_;
+    public:
+        using iterator_category = std::conditional_t<
+                is_counted && std::derived_from<typename Container::const_iterator::iterator_category,
+                                                std::bidirectional_iterator_tag>,
+                std::bidirectional_iterator_tag, typename Container::const_iterator::iterator_category>;
+        using iterator_concept = std::conditional_t<
+                !is_counted && std::contiguous_iterator<typename Container::const_iterator>,
+                std::contiguous_iterator_tag, iterator_category>;
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        using value_type = std::iter_value_t<typename Container::const_iterator>;
+        using reference = std::iter_reference_t<typename Container::const_iterator>;
+
+        iterator() = default;
+
+        explicit iterator(Container::const_iterator it, difference_type left = 0, const StageProbe<TakeView>& probe = {}):
+                iterator_(it), probe_(probe) {
+            if constexpr (is_counted) {
+                left_ = left;
             }
         }
 
-        auto operator*() const {
+        reference operator*() const {
+            probe_.dereference();
             return *iterator_;
         }
 
+        auto operator->() const requires std::contiguous_iterator<typename Container::const_iterator> {
+            return std::to_address(iterator_);
+        }
+
         iterator& operator++() {
+            probe_.increment();
             ++iterator_;
+            if constexpr (is_counted) {
+                --left_;
+            }
             return *this;
         }
 
@@ -247,7 +798,11 @@ public:
         }
 
         iterator& operator--() {
+            probe_.decrement();
             --iterator_;
+            if constexpr (is_counted) {
+                ++left_;
+            }
             return *this;
         }
 
@@ -257,6 +812,42 @@ public:
             return temp;
         }
 
+        iterator& operator+=(difference_type n) requires (!is_counted) {
+            probe_.seek(n);
+            iterator_ += n;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) requires (!is_counted) {
+            probe_.seek(-n);
+            iterator_ += -n;
+            return *this;
+        }
+
+        iterator operator+(difference_type n) const requires (!is_counted) {
+            iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend iterator operator+(difference_type n, const iterator& it) requires (!is_counted) {
+            return it + n;
+        }
+
+        iterator operator-(difference_type n) const requires (!is_counted) {
+            iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const iterator& other) const requires (!is_counted) {
+            return iterator_ - other.iterator_;
+        }
+
+        reference operator[](difference_type n) const requires (!is_counted) {
+            return *(*this + n);
+        }
+
         bool operator==(const iterator& other) const {
             return iterator_ == other.iterator_;
         }
@@ -265,39 +856,111 @@ public:
             return !(*this == other);
         }
 
-    private:
-        Container::const_iterator iterator_;
-        Container::const_iterator end_iterator_;
+        friend bool operator==(const iterator& it, const ViewSentinel<SentinelOf<Container>>& end) {
+            if constexpr (is_counted) {
+                if (it.left_ == 0) {
+                    return true;
+                }
+            }
+            return it.iterator_ == end.base();
+        }
+
+        auto operator<=>(const iterator& other) const requires std::three_way_comparable<typename Container::const_iterator> {
+            return iterator_ <=> other.iterator_;
+        }
+
+    private:
+        Container::const_iterator iterator_;
+        [[no_unique_address]] std::conditional_t<is_counted, difference_type, Uncounted> left_;
+        [[no_unique_address]] StageProbe<TakeView> probe_;
     };
 
     iterator begin() const {
-        return iterator(container_.begin(), to_take_n_, container_.begin(), container_.end());
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        return iterator(container_.begin(), static_cast<difference_type>(
+                std::min<size_t>(to_take_n_, std::numeric_limits<difference_type>::max())), probe_);
     }
 
-    iterator end() const {
-        return iterator(container_.end(), to_take_n_, container_.begin(), container_.end());
+    auto end() const {
+        if constexpr (is_counted) {
+            return ViewSentinel<SentinelOf<Container>>(container_.end());
+        } else {
+            return iterator(advance_bounded(container_.begin(), to_take_n_, container_.end()), 0, probe_);
+        }
+    }
+
+    size_t size() const requires IsSized<Container> {
+        return std::min<size_t>(to_take_n_, container_.size());
+    }
+
+    bool empty() const requires IsSized<Container> {
+        return size() == 0;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        size_t left = to_take_n_;
+        if (left == 0) {
+            return true;
+        }
+
+        bool stopped = false;
+        push_elements(container_, [&consumer, &left, &stopped](auto&& element) {
+            if (!consumer(element)) {
+                stopped = true;
+                return false;
+            }
+            return --left != 0;
+        });
+        return !stopped;
+    }
+
+    using base_type = Container;
+
+    const StoredContainer<Container>& base() const & {
+        return container_;
+    }
+
+    StoredContainer<Container> base() && {
+        return std::forward<StoredContainer<Container>>(container_);
+    }
+
+    size_t take_count() const {
+        return to_take_n_;
     }
 
 private:
-    Container& container_;
+    StoredContainer<Container> container_;
     const size_t to_take_n_;
+    [[no_unique_address]] StageProbe<TakeView> probe_;
 
 public:
     using const_iterator = iterator;
 };
 
 template <typename Container>
-TakeView<Container> take(Container& container, size_t to_take_n) {
-    return TakeView<Container>(container, to_take_n);
+auto take(Container& container, size_t to_take_n) {
+    return container | TakeViewParam(to_take_n);
 }
 
 TakeViewParam take(size_t n) {
     return {n};
 }
 
+template <typename T>
+constexpr bool is_take_view = false;
+
+template <typename Container>
+constexpr bool is_take_view<TakeView<Container>> = true;
+
 template<typename Container>
 auto operator|(Container&& container, TakeViewParam take_view_param) {
-    return TakeView<std::remove_reference_t<Container>>(container, take_view_param.n);
+    if constexpr (is_take_view<std::remove_cvref_t<Container>>) {
+        size_t n = std::min(container.take_count(), take_view_param.n);
+        return TakeView<RebasedContainer<Container>>(std::forward<Container>(container).base(), n);
+    } else {
+        return TakeView<ViewedContainer<Container>>(as_stored(std::forward<Container>(container)), take_view_param.n);
+    }
 }
 
 
@@ -308,27 +971,34 @@ class DropView {
 public:
     static_assert(IsContainer<Container>);
 
-    explicit DropView(Container& container, size_t n): container_(container), to_drop_n_(n) {}
+    explicit DropView(StoredContainer<Container> container, size_t n):
+            container_(std::forward<StoredContainer<Container>>(container)), to_drop_n_(n),
+            probe_(make_stage_probe<DropView>("drop")) {}
 
     class iterator {
     public:
         using iterator_category = Container::const_iterator::iterator_category;
+        using iterator_concept = std::conditional_t<std::contiguous_iterator<typename Container::const_iterator>,
+                                                    std::contiguous_iterator_tag, iterator_category>;
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        using value_type = std::iter_value_t<typename Container::const_iterator>;
+        using reference = std::iter_reference_t<typename Container::const_iterator>;
 
-        explicit iterator(Container::const_iterator it, size_t to_drop_n, Container::const_iterator end_iterator):
-                            iterator_(it) {
-            for (size_t i = 0; i < to_drop_n; ++i) {
-                if (iterator_ == end_iterator) {
-                    break;
-                }
-                ++iterator_;
-            }
-        }
+        iterator() = default;
+
+        explicit iterator(Container::const_iterator it, const StageProbe<DropView>& probe = {}): iterator_(it), probe_(probe) {}
 
-        auto operator*() const {
+        reference operator*() const {
+            probe_.dereference();
             return *iterator_;
         }
 
+        auto operator->() const requires std::contiguous_iterator<typename Container::const_iterator> {
+            return std::to_address(iterator_);
+        }
+
         iterator& operator++() {
+            probe_.increment();
             ++iterator_;
             return *this;
         }
@@ -340,6 +1010,7 @@ public:
         }
 
         iterator& operator--() {
+            probe_.decrement();
             --iterator_;
             return *this;
         }
@@ -351,6 +1022,42 @@ public:
         }
 
 
+        iterator& operator+=(difference_type n) requires IsSeekable<typename Container::const_iterator> {
+            probe_.seek(n);
+            iterator_ += n;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) requires IsSeekable<typename Container::const_iterator> {
+            probe_.seek(-n);
+            iterator_ += -n;
+            return *this;
+        }
+
+        iterator operator+(difference_type n) const requires IsSeekable<typename Container::const_iterator> {
+            iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend iterator operator+(difference_type n, const iterator& it) requires IsSeekable<typename Container::const_iterator> {
+            return it + n;
+        }
+
+        iterator operator-(difference_type n) const requires IsSeekable<typename Container::const_iterator> {
+            iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const iterator& other) const requires IsSeekable<typename Container::const_iterator> {
+            return iterator_ - other.iterator_;
+        }
+
+        reference operator[](difference_type n) const requires IsSeekable<typename Container::const_iterator> {
+            return *(*this + n);
+        }
+
         bool operator==(const iterator& other) const {
             return iterator_ == other.iterator_;
         }
@@ -359,38 +1066,124 @@ public:
             return !(*this == other);
         }
 
+        friend bool operator==(const iterator& it, const ViewSentinel<SentinelOf<Container>>& end) {
+            return it.iterator_ == end.base();
+        }
+
+        auto operator<=>(const iterator& other) const requires std::three_way_comparable<typename Container::const_iterator> {
+            return iterator_ <=> other.iterator_;
+        }
+
     private:
         Container::const_iterator iterator_;
+        [[no_unique_address]] StageProbe<DropView> probe_;
     };
 
+    // Over a seekable base the boundary is found in O(1), so it is recomputed on every call and stays valid after
+    // the container grows; only bases that have to be walked keep it.
     iterator begin() const {
-        return iterator(container_.begin(), to_drop_n_, container_.end());
+        if constexpr (seeks_in_constant_time) {
+            return iterator(advance_bounded(container_.begin(), to_drop_n_, container_.end()), probe_);
+        } else {
+            if (!begin_iterator_) {
+                begin_iterator_ = advance_bounded(container_.begin(), to_drop_n_, container_.end());
+            }
+            return iterator(*begin_iterator_, probe_);
+        }
     }
 
-    iterator end() const {
-        return iterator(container_.end(), to_drop_n_, container_.end());
+    auto end() const {
+        if constexpr (IsCommon<Container>) {
+            return iterator(container_.end(), probe_);
+        } else {
+            return ViewSentinel<SentinelOf<Container>>(container_.end());
+        }
+    }
+
+    size_t size() const requires IsSized<Container> {
+        size_t base_size = container_.size();
+        return base_size - std::min(to_drop_n_, base_size);
+    }
+
+    bool empty() const requires IsSized<Container> {
+        return size() == 0;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        if constexpr (IsSeekable<typename Container::const_iterator>) {
+            auto last = end();
+            for (auto it = begin(); it != last; ++it) {
+                if (!consumer(*it)) {
+                    return false;
+                }
+            }
+            return true;
+        } else {
+            size_t to_skip = to_drop_n_;
+            return push_elements(container_, [&consumer, &to_skip](auto&& element) {
+                if (to_skip != 0) {
+                    --to_skip;
+                    return true;
+                }
+                return consumer(element);
+            });
+        }
+    }
+
+    using base_type = Container;
+
+    const StoredContainer<Container>& base() const & {
+        return container_;
+    }
+
+    StoredContainer<Container> base() && {
+        return std::forward<StoredContainer<Container>>(container_);
+    }
+
+    size_t drop_count() const {
+        return to_drop_n_;
     }
 
 private:
-    Container& container_;
+    static constexpr bool seeks_in_constant_time =
+            IsSeekable<typename Container::const_iterator> &&
+            (IsCommon<Container> || std::same_as<SentinelOf<Container>, std::unreachable_sentinel_t>);
+
+    StoredContainer<Container> container_;
     const size_t to_drop_n_;
+    [[no_unique_address]] mutable std::conditional_t<
+            seeks_in_constant_time, std::tuple<>, NonPropagatingCache<typename Container::const_iterator>> begin_iterator_;
+    [[no_unique_address]] StageProbe<DropView> probe_;
 
 public:
     using const_iterator = iterator;
 };
 
 template <typename Container>
-DropView<Container> drop(Container& container, size_t to_drop_n) {
-    return DropView<Container>(container, to_drop_n);
+auto drop(Container& container, size_t to_drop_n) {
+    return container | DropViewParam(to_drop_n);
 }
 
 DropViewParam drop(size_t n) {
     return {n};
 }
 
+template <typename T>
+constexpr bool is_drop_view = false;
+
+template <typename Container>
+constexpr bool is_drop_view<DropView<Container>> = true;
+
 template<typename Container>
 auto operator|(Container&& container, DropViewParam take_view_param) {
-    return DropView<std::remove_reference_t<Container>>(container, take_view_param.n);
+    if constexpr (is_drop_view<std::remove_cvref_t<Container>>) {
+        size_t dropped = container.drop_count();
+        size_t n = std::min(take_view_param.n, std::numeric_limits<size_t>::max() - dropped) + dropped;
+        return DropView<RebasedContainer<Container>>(std::forward<Container>(container).base(), n);
+    } else {
+        return DropView<ViewedContainer<Container>>(as_stored(std::forward<Container>(container)), take_view_param.n);
+    }
 }
 
 
@@ -400,24 +1193,35 @@ class FilterView {
 public:
     static_assert(IsContainer<Container>);
 
-    explicit FilterView(Container& container, Condition condition): container_(container), condition_(condition) {}
+    explicit FilterView(StoredContainer<Container> container, Condition condition):
+            container_(std::forward<StoredContainer<Container>>(container)), condition_(std::move(condition)),
+            probe_(make_stage_probe<FilterView>("filter")) {}
 
     class iterator {
     public:
-        using iterator_category = Container::const_iterator::iterator_category;
+        using iterator_category = std::conditional_t<
+                std::derived_from<typename Container::const_iterator::iterator_category, std::bidirectional_iterator_tag>,
+                std::bidirectional_iterator_tag, typename Container::const_iterator::iterator_category>;
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        using value_type = std::iter_value_t<typename Container::const_iterator>;
+        using reference = std::iter_reference_t<typename Container::const_iterator>;
 
-        explicit iterator(Container::const_iterator it, Condition condition, Container::const_iterator end_iterator):
-                iterator_(it), condition_(condition), end_iterator_(end_iterator) {}
+        iterator() = default;
 
-        auto operator*() const {
+        explicit iterator(Container::const_iterator it, const FilterView* parent):
+                iterator_(it), parent_(parent), probe_(parent->probe_) {}
+
+        reference operator*() const {
+            probe_.dereference();
             return *iterator_;
         }
 
         iterator& operator++() {
+            probe_.increment();
             do {
                 ++iterator_;
             }
-            while ((iterator_ != end_iterator_) && (!condition_(*iterator_)));
+            while ((iterator_ != parent_->container_.end()) && (!probe_.call(parent_->condition_, *iterator_)));
 
             return *this;
         }
@@ -429,10 +1233,11 @@ public:
         }
 
         iterator& operator--() {
+            probe_.decrement();
             do {
                 --iterator_;
             }
-            while ((iterator_ != end_iterator_) && (!condition_(*iterator_)));
+            while (!probe_.call(parent_->condition_, *iterator_));
 
             return *this;
         }
@@ -451,27 +1256,82 @@ public:
             return !(*this == other);
         }
 
+        friend bool operator==(const iterator& it, const ViewSentinel<SentinelOf<Container>>& end) {
+            return it.iterator_ == end.base();
+        }
+
     private:
         Container::const_iterator iterator_;
-        Container::const_iterator end_iterator_;
-        Condition condition_;
+        const FilterView* parent_ = nullptr;
+        [[no_unique_address]] StageProbe<FilterView> probe_;
     };
 
+    // The first matching position is found once and reused by later begin() calls.
+    // Call refresh() after the container or the outcome of the condition changes.
     iterator begin() const {
-        auto iterator_ = container_.begin();
-        while ((iterator_ != container_.end()) && (!condition_(*iterator_))) {
-            ++iterator_;
+        if (!begin_iterator_) {
+            auto iterator_ = container_.begin();
+            while ((iterator_ != container_.end()) && (!probe_.call(condition_, *iterator_))) {
+                ++iterator_;
+            }
+            begin_iterator_ = iterator_;
         }
-        return iterator(iterator_, condition_, container_.end());
+        return iterator(*begin_iterator_, this);
     }
 
-    iterator end() const {
-        return iterator(container_.end(), condition_, container_.end());
+    auto end() const {
+        if constexpr (IsCommon<Container>) {
+            return iterator(container_.end(), this);
+        } else {
+            return ViewSentinel<SentinelOf<Container>>(container_.end());
+        }
+    }
+
+    void refresh() {
+        begin_iterator_.reset();
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        if constexpr (std::contiguous_iterator<typename Container::const_iterator> &&
+                      std::is_arithmetic_v<std::iter_value_t<typename Container::const_iterator>>) {
+            return push_selected(std::to_address(container_.begin()), std::to_address(container_.end()),
+                                 counted_condition(), consumer);
+        } else {
+            return push_elements(container_, [this, &consumer](auto&& element) {
+                return !probe_.call(condition_, element) || consumer(element);
+            });
+        }
+    }
+
+    size_t slice_extent() const requires IsSliceable<Container> {
+        return slice_extent_of(container_);
+    }
+
+    template <typename Consumer>
+    bool push_slice(size_t from, size_t to, Consumer&& consumer) const requires IsSliceable<Container> {
+        if constexpr (std::contiguous_iterator<typename Container::const_iterator> &&
+                      std::is_arithmetic_v<std::iter_value_t<typename Container::const_iterator>>) {
+            auto first = std::to_address(container_.begin());
+            return push_selected(first + from, first + to, counted_condition(), consumer);
+        } else {
+            return push_slice_elements(container_, from, to, [this, &consumer](auto&& element) {
+                return !probe_.call(condition_, element) || consumer(element);
+            });
+        }
     }
 
 private:
-    Container& container_;
+    auto counted_condition() const {
+        return [this](const auto& element) {
+            return probe_.call(condition_, element);
+        };
+    }
+
+    StoredContainer<Container> container_;
     Condition condition_;
+    mutable NonPropagatingCache<typename Container::const_iterator> begin_iterator_;
+    [[no_unique_address]] StageProbe<FilterView> probe_;
 
 public:
     using const_iterator = iterator;
@@ -479,17 +1339,18 @@ public:
 
 template <typename Container, typename Condition>
 FilterView<Container, Condition> filter(Container& container, Condition condition) {
-    return FilterView<Container, Condition>(container, condition);
+    return FilterView<Container, Condition>(container, std::move(condition));
 }
 
 template <typename FunctionType>
 FilterViewParam<FunctionType> filter(FunctionType function) {
-    return {function};
+    return {std::move(function)};
 }
 
 template<typename Container, typename FunctionType>
 auto operator|(Container&& container, FilterViewParam<FunctionType> take_view_param) {
-    return FilterView<std::remove_reference_t<Container>, FunctionType>(container, take_view_param.condition);
+    return FilterView<ViewedContainer<Container>, FunctionType>(as_stored(std::forward<Container>(container)),
+                                                                std::move(take_view_param.condition));
 }
 
 
@@ -498,19 +1359,29 @@ class TransformView {
 public:
     static_assert(IsContainer<Container>);
 
-    explicit TransformView(Container& container, Transform transform): container_(container), transform_(transform) {}
+    explicit TransformView(StoredContainer<Container> container, Transform transform):
+            container_(std::forward<StoredContainer<Container>>(container)), transform_(std::move(transform)),
+            probe_(make_stage_probe<TransformView>("transform")) {}
 
     class iterator {
     public:
         using iterator_category = Container::const_iterator::iterator_category;
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        using reference = std::invoke_result_t<const Transform&, std::iter_reference_t<typename Container::const_iterator>>;
+        using value_type = std::remove_cvref_t<reference>;
 
-        explicit iterator(Container::const_iterator it, Transform transform): iterator_(it), transform_(transform) {}
+        iterator() = default;
 
-        auto operator*() const {
-            return transform_(*iterator_);
+        explicit iterator(Container::const_iterator it, const TransformView* parent):
+                iterator_(it), parent_(parent), probe_(parent->probe_) {}
+
+        reference operator*() const {
+            probe_.dereference();
+            return probe_.call(parent_->transform_, *iterator_);
         }
 
         iterator& operator++() {
+            probe_.increment();
             ++iterator_;
             return *this;
         }
@@ -522,6 +1393,7 @@ public:
         }
 
         iterator& operator--() {
+            probe_.decrement();
             --iterator_;
             return *this;
         }
@@ -532,6 +1404,42 @@ public:
             return temp;
         }
 
+        iterator& operator+=(difference_type n) requires IsSeekable<typename Container::const_iterator> {
+            probe_.seek(n);
+            iterator_ += n;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) requires IsSeekable<typename Container::const_iterator> {
+            probe_.seek(-n);
+            iterator_ += -n;
+            return *this;
+        }
+
+        iterator operator+(difference_type n) const requires IsSeekable<typename Container::const_iterator> {
+            iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend iterator operator+(difference_type n, const iterator& it) requires IsSeekable<typename Container::const_iterator> {
+            return it + n;
+        }
+
+        iterator operator-(difference_type n) const requires IsSeekable<typename Container::const_iterator> {
+            iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const iterator& other) const requires IsSeekable<typename Container::const_iterator> {
+            return iterator_ - other.iterator_;
+        }
+
+        reference operator[](difference_type n) const requires IsSeekable<typename Container::const_iterator> {
+            return *(*this + n);
+        }
+
         bool operator==(const iterator& other) const {
             return iterator_ == other.iterator_;
         }
@@ -540,22 +1448,80 @@ public:
             return !(*this == other);
         }
 
+        friend bool operator==(const iterator& it, const ViewSentinel<SentinelOf<Container>>& end) {
+            return it.iterator_ == end.base();
+        }
+
+        auto operator<=>(const iterator& other) const requires std::three_way_comparable<typename Container::const_iterator> {
+            return iterator_ <=> other.iterator_;
+        }
+
     private:
         Container::const_iterator iterator_;
-        Transform transform_;
+        const TransformView* parent_ = nullptr;
+        [[no_unique_address]] StageProbe<TransformView> probe_;
     };
 
     iterator begin() const {
-        return iterator(container_.begin(), transform_);
+        return iterator(container_.begin(), this);
     }
 
-    iterator end() const {
-        return iterator(container_.end(), transform_);
+    auto end() const {
+        if constexpr (IsCommon<Container>) {
+            return iterator(container_.end(), this);
+        } else {
+            return ViewSentinel<SentinelOf<Container>>(container_.end());
+        }
+    }
+
+    size_t size() const requires IsSized<Container> {
+        return container_.size();
+    }
+
+    bool empty() const requires IsSized<Container> {
+        return size() == 0;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        return push_elements(container_, [this, &consumer](auto&& element) {
+            return consumer(probe_.call(transform_, std::forward<decltype(element)>(element)));
+        });
+    }
+
+    size_t slice_extent() const requires IsSliceable<Container> {
+        return slice_extent_of(container_);
+    }
+
+    template <typename Consumer>
+    bool push_slice(size_t from, size_t to, Consumer&& consumer) const requires IsSliceable<Container> {
+        return push_slice_elements(container_, from, to, [this, &consumer](auto&& element) {
+            return consumer(probe_.call(transform_, std::forward<decltype(element)>(element)));
+        });
+    }
+
+    using base_type = Container;
+
+    const StoredContainer<Container>& base() const & {
+        return container_;
+    }
+
+    StoredContainer<Container> base() && {
+        return std::forward<StoredContainer<Container>>(container_);
+    }
+
+    const Transform& function() const & {
+        return transform_;
+    }
+
+    Transform function() && {
+        return std::move(transform_);
     }
 
 private:
-    Container& container_;
+    StoredContainer<Container> container_;
     Transform transform_;
+    [[no_unique_address]] StageProbe<TransformView> probe_;
 
 public:
     using const_iterator = iterator;
@@ -563,18 +1529,43 @@ public:
 };
 
 template <typename Container, typename Transform>
-TransformView<Container, Transform> transform(Container& container, Transform transform) {
-    return TransformView<Container, Transform>(container, transform);
+auto transform(Container& container, Transform transform) {
+    return container | TransformViewParam<Transform>(std::move(transform));
 }
 
 template <typename FunctionType>
 TransformViewParam<FunctionType> transform(FunctionType function) {
-    return {function};
+    return {std::move(function)};
 }
 
+template <typename First, typename Second>
+struct ComposedTransform {
+    template <typename T>
+    decltype(auto) operator()(T&& element) const {
+        return second(first(std::forward<T>(element)));
+    }
+
+    First first;
+    Second second;
+};
+
+template <typename T>
+constexpr bool is_transform_view = false;
+
+template <typename Container, typename Transform>
+constexpr bool is_transform_view<TransformView<Container, Transform>> = true;
+
 template<typename Container, typename FunctionType>
 auto operator|(Container&& container, TransformViewParam<FunctionType> take_view_param) {
-    return TransformView<std::remove_reference_t<Container>, FunctionType>(container, take_view_param.function);
+    if constexpr (is_transform_view<std::remove_cvref_t<Container>>) {
+        using Composed = ComposedTransform<std::remove_cvref_t<decltype(container.function())>, FunctionType>;
+        Composed composed {std::forward<Container>(container).function(), std::move(take_view_param.function)};
+        return TransformView<RebasedContainer<Container>, Composed>(std::forward<Container>(container).base(),
+                                                                    std::move(composed));
+    } else {
+        return TransformView<ViewedContainer<Container>, FunctionType>(as_stored(std::forward<Container>(container)),
+                                                                       std::move(take_view_param.function));
+    }
 }
 
 
@@ -585,22 +1576,30 @@ public:
     static_assert(IsContainer<Container>);
     static_assert(std::derived_from<typename Container::const_iterator::iterator_category, std::bidirectional_iterator_tag>);
 
-    explicit ReverseView(Container& container): container_(container) {}
+    explicit ReverseView(StoredContainer<Container> container):
+            container_(std::forward<StoredContainer<Container>>(container)),
+            probe_(make_stage_probe<ReverseView>("reverse")) {}
 
     class iterator {
     public:
         using iterator_category = Container::const_iterator::iterator_category;
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        using value_type = std::iter_value_t<typename Container::const_iterator>;
+        using reference = std::iter_reference_t<typename Container::const_iterator>;
+
+        iterator() = default;
 
-        explicit iterator(Container::const_iterator it, Container::const_iterator begin_it, Container::const_iterator end_it):
-                        iterator_(it), begin_iterator_(begin_it), end_iterator_(end_it) {}
+        explicit iterator(Container::const_iterator it, const StageProbe<ReverseView>& probe = {}): iterator_(it), probe_(probe) {}
 
-        auto operator*() const {
+        reference operator*() const {
+            probe_.dereference();
             auto temp = iterator_;
             --temp;
             return *temp;
         }
 
         iterator& operator++() {
+            probe_.increment();
             --iterator_;
             return *this;
         }
@@ -612,6 +1611,7 @@ public:
         }
 
         iterator& operator--() {
+            probe_.decrement();
             ++iterator_;
             return *this;
         }
@@ -622,6 +1622,42 @@ public:
             return temp;
         }
 
+        iterator& operator+=(difference_type n) requires IsSeekable<typename Container::const_iterator> {
+            probe_.seek(n);
+            iterator_ += -n;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) requires IsSeekable<typename Container::const_iterator> {
+            probe_.seek(-n);
+            iterator_ += n;
+            return *this;
+        }
+
+        iterator operator+(difference_type n) const requires IsSeekable<typename Container::const_iterator> {
+            iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend iterator operator+(difference_type n, const iterator& it) requires IsSeekable<typename Container::const_iterator> {
+            return it + n;
+        }
+
+        iterator operator-(difference_type n) const requires IsSeekable<typename Container::const_iterator> {
+            iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const iterator& other) const requires IsSeekable<typename Container::const_iterator> {
+            return other.iterator_ - iterator_;
+        }
+
+        reference operator[](difference_type n) const requires IsSeekable<typename Container::const_iterator> {
+            return *(*this + n);
+        }
+
         bool operator==(const iterator& other) const {
             return iterator_ == other.iterator_;
         }
@@ -630,41 +1666,1933 @@ public:
             return !(*this == other);
         }
 
+        auto operator<=>(const iterator& other) const requires std::three_way_comparable<typename Container::const_iterator> {
+            return other.iterator_ <=> iterator_;
+        }
+
     private:
         Container::const_iterator iterator_;
-        Container::const_iterator begin_iterator_;
-        Container::const_iterator end_iterator_;
+        [[no_unique_address]] StageProbe<ReverseView> probe_;
     };
 
+    // A container that ends in a sentinel is walked once to find its last position, which is then cached.
     iterator begin() const {
-        return iterator(container_.end(), container_.begin(), container_.end());
+        if constexpr (IsCommon<Container>) {
+            return iterator(container_.end(), probe_);
+        } else {
+            if (!end_iterator_) {
+                auto it = container_.begin();
+                auto end = container_.end();
+                while (it != end) {
+                    ++it;
+                }
+                end_iterator_ = it;
+            }
+            return iterator(*end_iterator_, probe_);
+        }
     }
 
     iterator end() const {
-        return iterator(container_.begin(), container_.begin(), container_.end());
+        return iterator(container_.begin(), probe_);
+    }
+
+    size_t size() const requires IsSized<Container> {
+        return container_.size();
+    }
+
+    bool empty() const requires IsSized<Container> {
+        return size() == 0;
+    }
+
+    using base_type = Container;
+
+    const StoredContainer<Container>& base() const & {
+        return container_;
+    }
+
+    StoredContainer<Container> base() && {
+        return std::forward<StoredContainer<Container>>(container_);
     }
 
 private:
-    Container& container_;
+    StoredContainer<Container> container_;
+    mutable NonPropagatingCache<typename Container::const_iterator> end_iterator_;
+    [[no_unique_address]] StageProbe<ReverseView> probe_;
 
 public:
     using const_iterator = iterator;
 };
 
 template <typename Container>
-ReverseView<Container> reverse(Container& container) {
-    return ReverseView<Container>(container);
+auto reverse(Container& container) {
+    return container | ReverseViewParam();
 }
 
 ReverseViewParam reverse() {
     return {};
 }
 
+template <typename T>
+constexpr bool is_reverse_view = false;
+
+template <typename Container>
+constexpr bool is_reverse_view<ReverseView<Container>> = true;
+
+// Reversing a reverse view gives back the view's own container.
 template <typename Container>
 auto operator|(Container&& container, ReverseViewParam keys_view_param) {
-    return ReverseView<std::remove_reference_t<Container>>(container);
+    if constexpr (is_reverse_view<std::remove_cvref_t<Container>>) {
+        if constexpr (is_owning_view<RebasedContainer<Container>>) {
+            return std::forward<Container>(container).base();
+        } else {
+            return RefView<RebasedContainer<Container>>(std::forward<Container>(container).base());
+        }
+    } else {
+        return ReverseView<ViewedContainer<Container>>(as_stored(std::forward<Container>(container)));
+    }
+}
+
+
+
+template <typename Container>
+concept IsOrderedContainer = requires(const Container& container, const typename Container::key_type& key) {
+    container.key_comp();
+    { container.lower_bound(key) } -> std::same_as<typename Container::const_iterator>;
+};
+
+// A temporary ordered container is kept in an OwningView, and its bounds are searched in the container inside.
+template <typename Container>
+struct OrderedBase {
+    using type = Container;
+};
+
+template <typename Container>
+struct OrderedBase<OwningView<Container>> {
+    using type = Container;
+};
+
+template <typename Container>
+concept IsOrdered = IsOrderedContainer<typename OrderedBase<Container>::type>;
+
+template <typename Container>
+const typename OrderedBase<Container>::type& ordered_base(const Container& container) {
+    if constexpr (is_owning_view<Container>) {
+        return container.base();
+    } else {
+        return container;
+    }
+}
+
+template <typename Element>
+decltype(auto) key_of_element(const Element& element) {
+    if constexpr (requires { element.first; }) {
+        return (element.first);
+    } else {
+        return (element);
+    }
+}
+
+// Entries of an ordered container (std::map, std::set, FlatMap) with keys in [from, to), or from `from` on.
+// Both bounds are found with lower_bound in O(log n) on the first begin() and end() and then cached, so stages on top
+// that compare against end() on every step do not repeat the search. Call refresh() after adding or removing entries.
+// The iterators are the container's own.
+template <typename Container, typename Key>
+class KeyRangeView {
+public:
+    static_assert(IsContainer<Container>);
+    static_assert(IsOrdered<Container>);
+
+    explicit KeyRangeView(StoredContainer<Container> container, Key from, std::optional<Key> to):
+            container_(std::forward<StoredContainer<Container>>(container)), from_(std::move(from)), to_(std::move(to)) {}
+
+    Container::const_iterator begin() const {
+        if (!begin_iterator_) {
+            begin_iterator_ = ordered_base(container_).lower_bound(from_);
+        }
+        return *begin_iterator_;
+    }
+
+    Container::const_iterator end() const {
+        if (!end_iterator_) {
+            const auto& base = ordered_base(container_);
+            if (!to_) {
+                end_iterator_ = base.end();
+            } else if (base.key_comp()(*to_, from_)) {
+                end_iterator_ = begin();
+            } else {
+                end_iterator_ = base.lower_bound(*to_);
+            }
+        }
+        return *end_iterator_;
+    }
+
+    void refresh() {
+        begin_iterator_.reset();
+        end_iterator_.reset();
+    }
+
+    size_t size() const requires IsSeekable<typename Container::const_iterator> {
+        return end() - begin();
+    }
+
+    bool empty() const {
+        return begin() == end();
+    }
+
+private:
+    StoredContainer<Container> container_;
+    Key from_;
+    std::optional<Key> to_;
+    mutable NonPropagatingCache<typename Container::const_iterator> begin_iterator_;
+    mutable NonPropagatingCache<typename Container::const_iterator> end_iterator_;
+
+public:
+    using const_iterator = Container::const_iterator;
+};
+
+template <typename Key>
+KeyRangeViewParam<Key> key_range(Key from, Key to) {
+    return {std::move(from), std::move(to)};
+}
+
+template <typename Key>
+KeyRangeViewParam<Key> keys_from(Key from) {
+    return {std::move(from), std::nullopt};
+}
+
+template <typename Container, typename Key>
+auto operator|(Container&& container, KeyRangeViewParam<Key> key_range_view_param) {
+    return KeyRangeView<ViewedContainer<Container>, Key>(as_stored(std::forward<Container>(container)),
+                                                         std::move(key_range_view_param.from),
+                                                         std::move(key_range_view_param.to));
 }
 
 
+// Entries from the start for as long as the predicate holds for their keys (the element itself for sets).
+// The predicate must hold for a prefix of the keys and fail for the rest, as `key < limit` does on an ordered
+// container. On ordered containers with random access (FlatMap) the end is then found once by binary search and
+// cached, so call refresh() after changing the container; elsewhere the iterator stops at the first key that fails,
+// without looking further.
+template <typename Container, typename Predicate>
+class TakeWhileKeyView {
+public:
+    static_assert(IsContainer<Container>);
 
+    explicit TakeWhileKeyView(StoredContainer<Container> container, Predicate predicate):
+            container_(std::forward<StoredContainer<Container>>(container)), predicate_(std::move(predicate)) {}
 
+    static constexpr bool is_searched = IsOrdered<Container> && IsSeekable<typename Container::const_iterator> &&
+                                        IsCommon<Container>;
+
+    class iterator {
+    public:
+        using iterator_category = Container::const_iterator::iterator_category;
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        using value_type = std::iter_value_t<typename Container::const_iterator>;
+        using reference = std::iter_reference_t<typename Container::const_iterator>;
+
+        iterator() = default;
+
+        explicit iterator(Container::const_iterator it, const TakeWhileKeyView* parent): iterator_(it), parent_(parent) {}
+
+        reference operator*() const {
+            return *iterator_;
+        }
+
+        iterator& operator++() {
+            ++iterator_;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+
+        iterator& operator--() {
+            --iterator_;
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator temp = *this;
+            --(*this);
+            return temp;
+        }
+
+        iterator& operator+=(difference_type n) requires is_searched {
+            iterator_ += n;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) requires is_searched {
+            iterator_ += -n;
+            return *this;
+        }
+
+        iterator operator+(difference_type n) const requires is_searched {
+            iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend iterator operator+(difference_type n, const iterator& it) requires is_searched {
+            return it + n;
+        }
+
+        iterator operator-(difference_type n) const requires is_searched {
+            iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const iterator& other) const requires is_searched {
+            return iterator_ - other.iterator_;
+        }
+
+        reference operator[](difference_type n) const requires is_searched {
+            return *(*this + n);
+        }
+
+        bool operator==(const iterator& other) const {
+            return iterator_ == other.iterator_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+
+        friend bool operator==(const iterator& it, const ViewSentinel<SentinelOf<Container>>& end) {
+            return it.iterator_ == end.base() || !it.key_holds();
+        }
+
+        auto operator<=>(const iterator& other) const requires std::three_way_comparable<typename Container::const_iterator> {
+            return iterator_ <=> other.iterator_;
+        }
+
+    private:
+        bool key_holds() const {
+            return parent_->predicate_(key_of_element(*iterator_));
+        }
+
+        Container::const_iterator iterator_;
+        const TakeWhileKeyView* parent_ = nullptr;
+    };
+
+    iterator begin() const {
+        return iterator(container_.begin(), this);
+    }
+
+    auto end() const {
+        if constexpr (is_searched) {
+            if (!end_iterator_) {
+                end_iterator_ = std::partition_point(container_.begin(), container_.end(), [this](const auto& element) {
+                    return static_cast<bool>(predicate_(key_of_element(element)));
+                });
+            }
+            return iterator(*end_iterator_, this);
+        } else {
+            return ViewSentinel<SentinelOf<Container>>(container_.end());
+        }
+    }
+
+    void refresh() {
+        end_iterator_.reset();
+    }
+
+    size_t size() const requires is_searched {
+        return end() - begin();
+    }
+
+    bool empty() const requires is_searched {
+        return size() == 0;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        bool stopped = false;
+        push_elements(container_, [this, &consumer, &stopped](auto&& element) {
+            if (!predicate_(key_of_element(element))) {
+                return false;
+            }
+            if (!consumer(element)) {
+                stopped = true;
+                return false;
+            }
+            return true;
+        });
+        return !stopped;
+    }
+
+private:
+    StoredContainer<Container> container_;
+    Predicate predicate_;
+    mutable NonPropagatingCache<typename Container::const_iterator> end_iterator_;
+
+public:
+    using const_iterator = iterator;
+};
+
+template <typename Predicate>
+TakeWhileKeyViewParam<Predicate> take_while_key(Predicate predicate) {
+    return {std::move(predicate)};
+}
+
+template <typename Container, typename Predicate>
+auto operator|(Container&& container, TakeWhileKeyViewParam<Predicate> take_while_key_view_param) {
+    return TakeWhileKeyView<ViewedContainer<Container>, Predicate>(as_stored(std::forward<Container>(container)),
+                                                                   std::move(take_while_key_view_param.predicate));
+}
+
+
+
+// Evaluates the underlying element once per position and keeps it in the iterator, so stages that dereference the
+// same position several times (filter's condition and then the consumer, a reverse step) run an expensive transform
+// only once. Like std::istream_iterator it returns a reference into the iterator, which makes it single pass.
+template <typename Container>
+class Cache1View {
+public:
+    static_assert(IsContainer<Container>);
+
+    explicit Cache1View(StoredContainer<Container> container):
+            container_(std::forward<StoredContainer<Container>>(container)) {}
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        using value_type = std::remove_cvref_t<std::iter_reference_t<typename Container::const_iterator>>;
+        using reference = const value_type&;
+
+        iterator() = default;
+
+        explicit iterator(Container::const_iterator it): iterator_(it) {}
+
+        reference operator*() const {
+            if (!value_) {
+                value_ = *iterator_;
+            }
+            return *value_;
+        }
+
+        iterator& operator++() {
+            ++iterator_;
+            value_.reset();
+            return *this;
+        }
+
+        void operator++(int) {
+            ++(*this);
+        }
+
+        bool operator==(const iterator& other) const {
+            return iterator_ == other.iterator_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+
+        friend bool operator==(const iterator& it, const ViewSentinel<SentinelOf<Container>>& end) {
+            return it.iterator_ == end.base();
+        }
+
+    private:
+        Container::const_iterator iterator_;
+        mutable std::optional<value_type> value_;
+    };
+
+    iterator begin() const {
+        return iterator(container_.begin());
+    }
+
+    auto end() const {
+        if constexpr (IsCommon<Container>) {
+            return iterator(container_.end());
+        } else {
+            return ViewSentinel<SentinelOf<Container>>(container_.end());
+        }
+    }
+
+    size_t size() const requires IsSized<Container> {
+        return container_.size();
+    }
+
+    bool empty() const requires IsSized<Container> {
+        return size() == 0;
+    }
+
+    // Internal iteration already evaluates every element once.
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        return push_elements(container_, consumer);
+    }
+
+    size_t slice_extent() const requires IsSliceable<Container> {
+        return slice_extent_of(container_);
+    }
+
+    template <typename Consumer>
+    bool push_slice(size_t from, size_t to, Consumer&& consumer) const requires IsSliceable<Container> {
+        return push_slice_elements(container_, from, to, consumer);
+    }
+
+private:
+    StoredContainer<Container> container_;
+
+public:
+    using const_iterator = iterator;
+};
+
+Cache1ViewParam cache1() {
+    return {};
+}
+
+template <typename Container>
+auto operator|(Container&& container, Cache1ViewParam) {
+    return Cache1View<ViewedContainer<Container>>(as_stored(std::forward<Container>(container)));
+}
+
+
+
+// Over contiguous storage every chunk is a span into it. Otherwise elements are copied into a buffer owned by the
+// view and reused for every chunk, so iteration is single pass and a chunk is only valid until the next one is read.
+template <typename Container>
+class ChunkView {
+public:
+    static_assert(IsContainer<Container>);
+
+    static constexpr bool is_contiguous =
+            std::contiguous_iterator<typename Container::const_iterator> && IsCommon<Container>;
+
+    using element_type = std::iter_value_t<typename Container::const_iterator>;
+    using chunk_type = std::span<const element_type>;
+
+    explicit ChunkView(StoredContainer<Container> container, size_t n):
+            container_(std::forward<StoredContainer<Container>>(container)), chunk_size_(n) {}
+
+    class iterator {
+    public:
+        using iterator_category = std::conditional_t<is_contiguous, std::forward_iterator_tag, std::input_iterator_tag>;
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        using value_type = chunk_type;
+        using reference = chunk_type;
+
+        iterator() = default;
+
+        explicit iterator(Container::const_iterator it, const ChunkView* parent): iterator_(it), parent_(parent) {}
+
+        reference operator*() const {
+            if constexpr (is_contiguous) {
+                auto chunk_end = advance_bounded(iterator_, parent_->chunk_size_, parent_->container_.end());
+                return chunk_type(std::to_address(iterator_), static_cast<size_t>(chunk_end - iterator_));
+            } else {
+                return chunk_type(parent_->buffer_);
+            }
+        }
+
+        iterator& operator++() {
+            if constexpr (is_contiguous) {
+                iterator_ = advance_bounded(iterator_, parent_->chunk_size_, parent_->container_.end());
+            } else {
+                parent_->fill_buffer(iterator_);
+            }
+            return *this;
+        }
+
+        iterator operator++(int) requires is_contiguous {
+            iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+
+        void operator++(int) requires (!is_contiguous) {
+            ++(*this);
+        }
+
+        bool operator==(const iterator& other) const {
+            return iterator_ == other.iterator_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+
+        bool operator==(std::default_sentinel_t) const requires (!is_contiguous) {
+            return parent_->buffer_.empty();
+        }
+
+    private:
+        Container::const_iterator iterator_;
+        const ChunkView* parent_ = nullptr;
+    };
+
+    iterator begin() const {
+        auto it = container_.begin();
+        if constexpr (!is_contiguous) {
+            fill_buffer(it);
+        }
+        return iterator(it, this);
+    }
+
+    auto end() const {
+        if constexpr (is_contiguous) {
+            return iterator(container_.end(), this);
+        } else {
+            return std::default_sentinel;
+        }
+    }
+
+    size_t size() const requires IsSized<Container> {
+        return (container_.size() + chunk_size_ - 1) / chunk_size_;
+    }
+
+    bool empty() const requires IsSized<Container> {
+        return size() == 0;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        if constexpr (is_contiguous) {
+            auto last = end();
+            for (auto it = begin(); it != last; ++it) {
+                if (!consumer(*it)) {
+                    return false;
+                }
+            }
+            return true;
+        } else {
+            buffer_.clear();
+            buffer_.reserve(std::min<size_t>(chunk_size_, max_reserved_chunk_size));
+            bool stopped = false;
+            push_elements(container_, [this, &consumer, &stopped](auto&& element) {
+                buffer_.push_back(std::forward<decltype(element)>(element));
+                if (buffer_.size() == chunk_size_) {
+                    stopped = !consumer(chunk_type(buffer_));
+                    buffer_.clear();
+                }
+                return !stopped;
+            });
+            if (stopped) {
+                return false;
+            }
+            return buffer_.empty() || consumer(chunk_type(buffer_));
+        }
+    }
+
+private:
+    static constexpr size_t max_reserved_chunk_size = 1 << 16;
+
+    void fill_buffer(Container::const_iterator& it) const {
+        buffer_.clear();
+        buffer_.reserve(std::min<size_t>(chunk_size_, max_reserved_chunk_size));
+        auto end = container_.end();
+        for (; buffer_.size() < chunk_size_ && it != end; ++it) {
+            buffer_.push_back(*it);
+        }
+    }
+
+    StoredContainer<Container> container_;
+    const size_t chunk_size_;
+    mutable std::vector<element_type> buffer_;
+
+public:
+    using const_iterator = iterator;
+};
+
+template <typename Container>
+ChunkView<Container> chunk(Container& container, size_t n) {
+    return container | ChunkViewParam(n);
+}
+
+ChunkViewParam chunk(size_t n) {
+    return {n};
+}
+
+template <typename Container>
+auto operator|(Container&& container, ChunkViewParam chunk_view_param) {
+    return ChunkView<ViewedContainer<Container>>(as_stored(std::forward<Container>(container)), chunk_view_param.n);
+}
+
+
+
+// Runs the function on a thread pool ahead of the consumer, at most `window` elements ahead, and yields the results in
+// input order. Elements are copied into the tasks, and results are handed out as they are consumed, so memory stays
+// bounded by the window. The view is single pass: begin() restarts from the first element and drops results in flight.
+// Dropped results are waited for, so the function never runs after the terminal or the view that started it is gone
+// and may refer to the caller's locals.
+// With workers == 0 the default pool is used; window == 0 picks twice the number of pool threads.
+template <typename Container, typename Function>
+class AsyncTransformView {
+public:
+    static_assert(IsContainer<Container>);
+
+    using element_type = std::iter_value_t<typename Container::const_iterator>;
+    using result_type = std::remove_cvref_t<std::invoke_result_t<const Function&, const element_type&>>;
+
+    explicit AsyncTransformView(StoredContainer<Container> container, Function function, size_t workers, size_t window):
+            container_(std::forward<StoredContainer<Container>>(container)),
+            function_(std::make_shared<const Function>(std::move(function))),
+            pool_(workers != 0 ? std::make_shared<ThreadPool>(workers) : nullptr),
+            window_(window != 0 ? window : 2 * pool().size()) {}
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = result_type;
+        using reference = const result_type&;
+
+        iterator() = default;
+
+        explicit iterator(const AsyncTransformView* parent): parent_(parent) {}
+
+        reference operator*() const {
+            return parent_->current();
+        }
+
+        iterator& operator++() {
+            parent_->advance();
+            return *this;
+        }
+
+        void operator++(int) {
+            ++(*this);
+        }
+
+        bool operator==(std::default_sentinel_t) const {
+            return parent_->in_flight_->empty();
+        }
+
+    private:
+        const AsyncTransformView* parent_ = nullptr;
+    };
+
+    iterator begin() const {
+        position_ = container_.begin();
+        in_flight_.reset();
+        in_flight_.emplace(pool());
+        current_.reset();
+        while (in_flight_->size() < window_ && *position_ != container_.end()) {
+            submit_next(*in_flight_, *position_);
+        }
+        return iterator(this);
+    }
+
+    std::default_sentinel_t end() const {
+        return std::default_sentinel;
+    }
+
+    size_t size() const requires IsSized<Container> {
+        return container_.size();
+    }
+
+    bool empty() const requires IsSized<Container> {
+        return size() == 0;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        InFlight in_flight(pool());
+        typename Container::const_iterator position = container_.begin();
+        auto end = container_.end();
+        while (in_flight.size() < window_ && position != end) {
+            submit_next(in_flight, position);
+        }
+
+        while (!in_flight.empty()) {
+            pool().wait(in_flight.front());
+            result_type result = in_flight.front().get();
+            in_flight.pop_front();
+            if (position != end) {
+                submit_next(in_flight, position);
+            }
+            if (!consumer(result)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    class InFlight : public std::deque<std::future<result_type>> {
+    public:
+        explicit InFlight(ThreadPool& pool): pool_(pool) {}
+
+        InFlight(const InFlight&) = delete;
+        InFlight& operator=(const InFlight&) = delete;
+
+        ~InFlight() {
+            for (auto& future: *this) {
+                if (future.valid()) {
+                    pool_.wait(future);
+                }
+            }
+        }
+
+    private:
+        ThreadPool& pool_;
+    };
+
+    ThreadPool& pool() const {
+        return pool_ ? *pool_ : default_thread_pool();
+    }
+
+    void submit_next(std::deque<std::future<result_type>>& in_flight, Container::const_iterator& position) const {
+        in_flight.push_back(pool().submit([function = function_, element = element_type(*position)] {
+            return result_type((*function)(element));
+        }));
+        ++position;
+    }
+
+    const result_type& current() const {
+        if (!current_) {
+            pool().wait(in_flight_->front());
+            current_ = in_flight_->front().get();
+        }
+        return *current_;
+    }
+
+    void advance() const {
+        in_flight_->pop_front();
+        current_.reset();
+        if (*position_ != container_.end()) {
+            submit_next(*in_flight_, *position_);
+        }
+    }
+
+    StoredContainer<Container> container_;
+    std::shared_ptr<const Function> function_;
+    std::shared_ptr<ThreadPool> pool_;
+    size_t window_;
+    mutable NonPropagatingCache<typename Container::const_iterator> position_;
+    mutable NonPropagatingCache<InFlight> in_flight_;
+    mutable NonPropagatingCache<result_type> current_;
+
+public:
+    using const_iterator = iterator;
+};
+
+template <typename Function>
+AsyncTransformViewParam<Function> async_transform(Function function, size_t workers = 0, size_t window = 0) {
+    return {std::move(function), workers, window};
+}
+
+template <typename Container, typename Function>
+auto operator|(Container&& container, AsyncTransformViewParam<Function> async_transform_view_param) {
+    return AsyncTransformView<ViewedContainer<Container>, Function>(
+            as_stored(std::forward<Container>(container)), std::move(async_transform_view_param.function),
+            async_transform_view_param.workers, async_transform_view_param.window);
+}
+
+
+
+// Sources: views that produce their elements instead of reading a container, so a pipeline can run
+// over ids or input without materializing them first.
+template <typename T, bool IsBounded>
+class IotaView {
+public:
+    static_assert(std::is_integral_v<T>);
+
+    // A bound below the start gives an empty range, as if it were the start itself.
+    explicit IotaView(T first, T last = T()): first_(first), last_(IsBounded ? std::max(first, last) : last) {}
+
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T;
+        using reference = T;
+
+        iterator() = default;
+
+        explicit iterator(T value): value_(value) {}
+
+        reference operator*() const {
+            return value_;
+        }
+
+        iterator& operator++() {
+            ++value_;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+
+        iterator& operator--() {
+            --value_;
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator temp = *this;
+            --(*this);
+            return temp;
+        }
+
+        iterator& operator+=(difference_type n) {
+            value_ = static_cast<T>(value_ + n);
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) {
+            value_ = static_cast<T>(value_ - n);
+            return *this;
+        }
+
+        iterator operator+(difference_type n) const {
+            iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend iterator operator+(difference_type n, const iterator& it) {
+            return it + n;
+        }
+
+        iterator operator-(difference_type n) const {
+            iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const iterator& other) const {
+            return static_cast<difference_type>(value_) - static_cast<difference_type>(other.value_);
+        }
+
+        reference operator[](difference_type n) const {
+            return *(*this + n);
+        }
+
+        bool operator==(const iterator& other) const {
+            return value_ == other.value_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+
+        auto operator<=>(const iterator& other) const {
+            return value_ <=> other.value_;
+        }
+
+    private:
+        T value_ = T();
+    };
+
+    iterator begin() const {
+        return iterator(first_);
+    }
+
+    auto end() const {
+        if constexpr (IsBounded) {
+            return iterator(last_);
+        } else {
+            return std::unreachable_sentinel;
+        }
+    }
+
+    size_t size() const requires IsBounded {
+        return static_cast<size_t>(end() - begin());
+    }
+
+    bool empty() const requires IsBounded {
+        return first_ == last_;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        for (T value = first_; !IsBounded || value != last_; ++value) {
+            if (!consumer(value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    T first_;
+    T last_;
+
+public:
+    using const_iterator = iterator;
+};
+
+template <typename T>
+IotaView<T, true> iota(T first, T last) {
+    return IotaView<T, true>(first, last);
+}
+
+template <typename T>
+IotaView<T, false> iota(T first) {
+    return IotaView<T, false>(first);
+}
+
+
+
+template <typename T>
+class RepeatView {
+public:
+    explicit RepeatView(T value, size_t count): value_(std::move(value)), count_(count) {}
+
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T;
+        using reference = const T&;
+
+        iterator() = default;
+
+        explicit iterator(const RepeatView* parent, difference_type index): parent_(parent), index_(index) {}
+
+        reference operator*() const {
+            return parent_->value_;
+        }
+
+        iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+
+        iterator& operator--() {
+            --index_;
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator temp = *this;
+            --(*this);
+            return temp;
+        }
+
+        iterator& operator+=(difference_type n) {
+            index_ += n;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) {
+            index_ -= n;
+            return *this;
+        }
+
+        iterator operator+(difference_type n) const {
+            iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend iterator operator+(difference_type n, const iterator& it) {
+            return it + n;
+        }
+
+        iterator operator-(difference_type n) const {
+            iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const iterator& other) const {
+            return index_ - other.index_;
+        }
+
+        reference operator[](difference_type n) const {
+            return *(*this + n);
+        }
+
+        bool operator==(const iterator& other) const {
+            return index_ == other.index_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+
+        auto operator<=>(const iterator& other) const {
+            return index_ <=> other.index_;
+        }
+
+    private:
+        const RepeatView* parent_ = nullptr;
+        difference_type index_ = 0;
+    };
+
+    iterator begin() const {
+        return iterator(this, 0);
+    }
+
+    iterator end() const {
+        return iterator(this, static_cast<std::ptrdiff_t>(count_));
+    }
+
+    size_t size() const {
+        return count_;
+    }
+
+    bool empty() const {
+        return count_ == 0;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        for (size_t i = 0; i < count_; ++i) {
+            if (!consumer(value_)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    T value_;
+    size_t count_;
+
+public:
+    using const_iterator = iterator;
+};
+
+template <typename T>
+RepeatView<T> repeat(T value, size_t count) {
+    return RepeatView<T>(std::move(value), count);
+}
+
+
+
+// Single pass and unbounded: begin() calls the function for the first element and every increment calls it again.
+template <typename Function>
+class GenerateView {
+public:
+    using value_type = std::remove_cvref_t<std::invoke_result_t<Function&>>;
+
+    explicit GenerateView(Function function): function_(std::move(function)) {}
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = GenerateView::value_type;
+        using reference = const value_type&;
+
+        iterator() = default;
+
+        explicit iterator(const GenerateView* parent): parent_(parent) {}
+
+        reference operator*() const {
+            return *parent_->value_;
+        }
+
+        iterator& operator++() {
+            parent_->value_ = parent_->function_();
+            return *this;
+        }
+
+        void operator++(int) {
+            ++(*this);
+        }
+
+        bool operator==(std::unreachable_sentinel_t) const {
+            return false;
+        }
+
+    private:
+        const GenerateView* parent_ = nullptr;
+    };
+
+    iterator begin() const {
+        value_ = function_();
+        return iterator(this);
+    }
+
+    std::unreachable_sentinel_t end() const {
+        return std::unreachable_sentinel;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        while (consumer(function_())) {
+        }
+        return false;
+    }
+
+private:
+    mutable Function function_;
+    mutable NonPropagatingCache<value_type> value_;
+
+public:
+    using const_iterator = iterator;
+};
+
+template <typename Function>
+GenerateView<Function> generate(Function function) {
+    return GenerateView<Function>(std::move(function));
+}
+
+
+
+// Single pass: reads values with operator>> until extraction fails. The stream is referenced, not owned.
+template <typename T>
+class IstreamView {
+public:
+    explicit IstreamView(std::istream& stream): stream_(&stream) {}
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T;
+        using reference = const T&;
+
+        iterator() = default;
+
+        explicit iterator(const IstreamView* parent): parent_(parent) {}
+
+        reference operator*() const {
+            return parent_->value_;
+        }
+
+        iterator& operator++() {
+            *parent_->stream_ >> parent_->value_;
+            return *this;
+        }
+
+        void operator++(int) {
+            ++(*this);
+        }
+
+        bool operator==(std::default_sentinel_t) const {
+            return !*parent_->stream_;
+        }
+
+    private:
+        const IstreamView* parent_ = nullptr;
+    };
+
+    iterator begin() const {
+        *stream_ >> value_;
+        return iterator(this);
+    }
+
+    std::default_sentinel_t end() const {
+        return std::default_sentinel;
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        while (*stream_ >> value_) {
+            if (!consumer(value_)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::istream* stream_;
+    mutable T value_ = T();
+
+public:
+    using const_iterator = iterator;
+};
+
+template <typename T>
+IstreamView<T> from_istream(std::istream& stream) {
+    return IstreamView<T>(stream);
+}
+
+
+
+// Space for one object of an erased type: inside the buffer when it fits and moves without throwing, otherwise on
+// the heap with the buffer holding the pointer. The owner remembers the type and passes it back to every call.
+template <size_t Capacity>
+class ErasedStorage {
+public:
+    template <typename Object>
+    static constexpr bool is_inline = sizeof(Object) <= Capacity && alignof(Object) <= alignof(std::max_align_t) &&
+                                      std::is_nothrow_move_constructible_v<Object>;
+
+    template <typename Object, typename... Args>
+    void construct(Args&&... args) {
+        if constexpr (is_inline<Object>) {
+            new (buffer_) Object(std::forward<Args>(args)...);
+        } else {
+            new (buffer_) Object*(new Object(std::forward<Args>(args)...));
+        }
+    }
+
+    template <typename Object>
+    Object& get() {
+        if constexpr (is_inline<Object>) {
+            return *std::launder(reinterpret_cast<Object*>(buffer_));
+        } else {
+            return **std::launder(reinterpret_cast<Object**>(buffer_));
+        }
+    }
+
+    template <typename Object>
+    const Object& get() const {
+        return const_cast<ErasedStorage*>(this)->get<Object>();
+    }
+
+    template <typename Object>
+    void copy_to(ErasedStorage& other) const {
+        other.construct<Object>(get<Object>());
+    }
+
+    template <typename Object>
+    void move_to(ErasedStorage& other) noexcept {
+        if constexpr (is_inline<Object>) {
+            other.construct<Object>(std::move(get<Object>()));
+            get<Object>().~Object();
+        } else {
+            new (other.buffer_) Object*(&get<Object>());
+        }
+    }
+
+    template <typename Object>
+    void destroy() noexcept {
+        if constexpr (is_inline<Object>) {
+            get<Object>().~Object();
+        } else {
+            delete &get<Object>();
+        }
+    }
+
+private:
+    alignas(std::max_align_t) std::byte buffer_[Capacity];
+};
+
+// Input iterator over the elements of any container, converted to T. The erased iterator and its end are kept
+// together, so the end of the range is the plain std::default_sentinel. Up to buffer_size bytes of them are stored
+// in place, which covers the iterators of pipelines a few stages deep, so copying one does not allocate.
+template <typename T>
+class AnyIterator {
+    static constexpr size_t buffer_size = 64;
+    using Storage = ErasedStorage<buffer_size>;
+
+    struct Operations {
+        void (*copy)(const Storage&, Storage&);
+        void (*move)(Storage&, Storage&) noexcept;
+        void (*destroy)(Storage&) noexcept;
+        T (*dereference)(const Storage&);
+        void (*increment)(Storage&);
+        bool (*at_end)(const Storage&);
+        size_t (*next_n)(Storage&, std::span<T>);
+        bool is_inline;
+    };
+
+    template <typename Iterator, typename Sentinel>
+    struct Cursor {
+        Iterator current;
+        Sentinel end;
+    };
+
+    template <typename State>
+    static constexpr Operations operations = {
+            [](const Storage& from, Storage& to) {
+                from.template copy_to<State>(to);
+            },
+            [](Storage& from, Storage& to) noexcept {
+                from.template move_to<State>(to);
+            },
+            [](Storage& storage) noexcept {
+                storage.template destroy<State>();
+            },
+            [](const Storage& storage) -> T {
+                return *storage.template get<State>().current;
+            },
+            [](Storage& storage) {
+                ++storage.template get<State>().current;
+            },
+            [](const Storage& storage) {
+                const State& state = storage.template get<State>();
+                return static_cast<bool>(state.current == state.end);
+            },
+            [](Storage& storage, std::span<T> out) {
+                State& state = storage.template get<State>();
+                size_t n = 0;
+                for (; n < out.size() && !(state.current == state.end); ++n, ++state.current) {
+                    out[n] = *state.current;
+                }
+                return n;
+            },
+            Storage::template is_inline<State>,
+    };
+
+public:
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = T;
+    using reference = T;
+
+    AnyIterator() = default;
+
+    template <typename Iterator, typename Sentinel>
+    AnyIterator(Iterator it, Sentinel end): operations_(&operations<Cursor<Iterator, Sentinel>>) {
+        storage_.template construct<Cursor<Iterator, Sentinel>>(std::move(it), std::move(end));
+    }
+
+    AnyIterator(const AnyIterator& other): operations_(other.operations_) {
+        if (operations_ != nullptr) {
+            operations_->copy(other.storage_, storage_);
+        }
+    }
+
+    AnyIterator(AnyIterator&& other) noexcept: operations_(std::exchange(other.operations_, nullptr)) {
+        if (operations_ != nullptr) {
+            operations_->move(other.storage_, storage_);
+        }
+    }
+
+    AnyIterator& operator=(AnyIterator other) noexcept {
+        reset();
+        operations_ = std::exchange(other.operations_, nullptr);
+        if (operations_ != nullptr) {
+            operations_->move(other.storage_, storage_);
+        }
+        return *this;
+    }
+
+    ~AnyIterator() {
+        reset();
+    }
+
+    T operator*() const {
+        return operations_->dereference(storage_);
+    }
+
+    AnyIterator& operator++() {
+        operations_->increment(storage_);
+        return *this;
+    }
+
+    AnyIterator operator++(int) {
+        AnyIterator temp = *this;
+        ++(*this);
+        return temp;
+    }
+
+    friend bool operator==(const AnyIterator& it, std::default_sentinel_t) {
+        return it.operations_ == nullptr || it.operations_->at_end(it.storage_);
+    }
+
+    // Copies up to out.size() next elements into out and moves past them; returns how many there were. One indirect
+    // call per batch instead of three per element.
+    size_t next_n(std::span<T> out) {
+        return operations_ == nullptr ? 0 : operations_->next_n(storage_, out);
+    }
+
+    bool is_inline() const {
+        return operations_ == nullptr || operations_->is_inline;
+    }
+
+private:
+    void reset() {
+        if (operations_ != nullptr) {
+            operations_->destroy(storage_);
+            operations_ = nullptr;
+        }
+    }
+
+    const Operations* operations_ = nullptr;
+    Storage storage_;
+};
+
+// A pipeline of any type behind one type, for struct members and interfaces between translation units:
+// AnyView<int> numbers = v | filter(f) | transform(g). Named containers and views are referenced, temporaries are
+// moved in. Views up to buffer_size bytes are stored in place, so a usual pipeline is erased without allocating;
+// iteration costs an indirect call per step, and push terminals read it in batches through next_n().
+template <typename T>
+class AnyView {
+    static constexpr size_t buffer_size = 128;
+    static constexpr size_t batch_size = 64;
+    using Storage = ErasedStorage<buffer_size>;
+
+    struct Operations {
+        void (*copy)(const Storage&, Storage&);
+        void (*move)(Storage&, Storage&) noexcept;
+        void (*destroy)(Storage&) noexcept;
+        AnyIterator<T> (*begin)(const Storage&);
+        bool is_inline;
+    };
+
+    template <typename View>
+    static constexpr Operations operations = {
+            [](const Storage& from, Storage& to) {
+                from.template copy_to<View>(to);
+            },
+            [](Storage& from, Storage& to) noexcept {
+                from.template move_to<View>(to);
+            },
+            [](Storage& storage) noexcept {
+                storage.template destroy<View>();
+            },
+            [](const Storage& storage) {
+                const View& view = storage.template get<View>();
+                return AnyIterator<T>(view.begin(), view.end());
+            },
+            Storage::template is_inline<View>,
+    };
+
+    template <typename Container>
+    using Erased = std::conditional_t<std::is_lvalue_reference_v<Container>, RefView<std::remove_reference_t<Container>>,
+                                      std::remove_cvref_t<Container>>;
+
+public:
+    template <typename Container>
+    requires (!std::same_as<std::remove_cvref_t<Container>, AnyView>)
+    AnyView(Container&& container): operations_(&operations<Erased<Container>>) {
+        static_assert(IsContainer<Erased<Container>>);
+        static_assert(std::convertible_to<std::iter_reference_t<typename Erased<Container>::const_iterator>, T>);
+        storage_.template construct<Erased<Container>>(std::forward<Container>(container));
+    }
+
+    AnyView(const AnyView& other): operations_(other.operations_) {
+        if (operations_ != nullptr) {
+            operations_->copy(other.storage_, storage_);
+        }
+    }
+
+    // A moved-from AnyView is empty.
+    AnyView(AnyView&& other) noexcept: operations_(std::exchange(other.operations_, nullptr)) {
+        if (operations_ != nullptr) {
+            operations_->move(other.storage_, storage_);
+        }
+    }
+
+    AnyView& operator=(AnyView other) noexcept {
+        reset();
+        operations_ = std::exchange(other.operations_, nullptr);
+        if (operations_ != nullptr) {
+            operations_->move(other.storage_, storage_);
+        }
+        return *this;
+    }
+
+    ~AnyView() {
+        reset();
+    }
+
+    AnyIterator<T> begin() const {
+        return operations_ == nullptr ? AnyIterator<T>() : operations_->begin(storage_);
+    }
+
+    std::default_sentinel_t end() const {
+        return {};
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        auto it = begin();
+        if constexpr (std::is_default_constructible_v<T>) {
+            std::array<T, batch_size> batch;
+            while (size_t n = it.next_n(batch)) {
+                for (size_t i = 0; i < n; ++i) {
+                    if (!consumer(batch[i])) {
+                        return false;
+                    }
+                }
+            }
+        } else {
+            for (; it != end(); ++it) {
+                if (!consumer(*it)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool is_inline() const {
+        return operations_ == nullptr || operations_->is_inline;
+    }
+
+private:
+    void reset() {
+        if (operations_ != nullptr) {
+            operations_->destroy(storage_);
+            operations_ = nullptr;
+        }
+    }
+
+    const Operations* operations_ = nullptr;
+    Storage storage_;
+
+public:
+    using const_iterator = AnyIterator<T>;
+};
+
+template <typename Container>
+AnyView(Container&&) -> AnyView<std::iter_value_t<typename std::remove_cvref_t<Container>::const_iterator>>;
+
+
+
+template <typename Function>
+struct ForEachParam {
+    ForEachParam(Function function): function(std::move(function)) {}
+    Function function;
+};
+
+template <typename T, typename Operation>
+struct ReduceParam {
+    ReduceParam(T init, Operation operation): init(std::move(init)), operation(std::move(operation)) {}
+    T init;
+    Operation operation;
+};
+
+struct CountParam {};
+
+template <typename Result>
+struct ToParam {};
+
+template <typename Function>
+ForEachParam<Function> for_each(Function function) {
+    return {std::move(function)};
+}
+
+template <typename T, typename Operation>
+ReduceParam<T, Operation> reduce(T init, Operation operation) {
+    return {std::move(init), std::move(operation)};
+}
+
+CountParam count() {
+    return {};
+}
+
+template <typename Result>
+ToParam<Result> to() {
+    return {};
+}
+
+template <typename Container, typename Function>
+Function operator|(const Container& container, ForEachParam<Function> for_each_param) {
+    push_elements(container, [&for_each_param](auto&& element) {
+        for_each_param.function(element);
+        return true;
+    });
+    return std::move(for_each_param.function);
+}
+
+template <typename Container, typename T, typename Operation>
+T operator|(const Container& container, ReduceParam<T, Operation> reduce_param) {
+    push_elements(container, [&reduce_param](auto&& element) {
+        reduce_param.init = reduce_param.operation(std::move(reduce_param.init), element);
+        return true;
+    });
+    return std::move(reduce_param.init);
+}
+
+template <typename Container>
+size_t operator|(const Container& container, CountParam) {
+    size_t result = 0;
+    push_elements(container, [&result](auto&&) {
+        ++result;
+        return true;
+    });
+    return result;
+}
+
+// Reserves once when both the pipeline and the result know their size; otherwise the result grows on its own.
+template <typename Container, typename Result>
+Result operator|(const Container& container, ToParam<Result>) {
+    Result result;
+    if constexpr (IsSized<Container> && requires { result.reserve(container.size()); }) {
+        result.reserve(container.size());
+    }
+    push_elements(container, [&result](auto&& element) {
+        result.insert(result.end(), std::forward<decltype(element)>(element));
+        return true;
+    });
+    return result;
+}
+
+
+
+// Parallel terminals run a sliceable pipeline (see IsSliceable) on the default thread pool and combine the partial
+// results in source order. The whole range starts as a single task; while some worker is idle, a task hands the back
+// half of what it has left to the pool, so ranges where the filter is expensive keep being split and stolen instead of
+// one chunk holding up the rest.
+// Functions passed to them, and the functions inside the pipeline, are called concurrently.
+constexpr size_t parallel_grain_size = 2048;
+
+template <typename SliceTask>
+auto run_in_slices(size_t size, const SliceTask& slice_task) {
+    using Result = std::invoke_result_t<const SliceTask&, size_t, size_t>;
+
+    // Spawned tasks share the state and keep it alive, since a worker may still be returning from a task after it
+    // counted its last slice and the caller has moved on.
+    struct SliceRun {
+        SliceRun(const SliceTask& slice_task, size_t size): slice_task(slice_task), remaining(size) {}
+
+        static void process(const std::shared_ptr<SliceRun>& run, size_t from, size_t to) {
+            while (from < to) {
+                if (to - from >= 2 * parallel_grain_size && run->pool.has_idle_workers()) {
+                    size_t middle = from + (to - from) / 2;
+                    run->pool.spawn([run, middle, to] {
+                        process(run, middle, to);
+                    });
+                    to = middle;
+                    continue;
+                }
+
+                size_t slice_end = std::min(to, from + parallel_grain_size);
+                if (!run->failed) {
+                    try {
+                        Result result = run->slice_task(from, slice_end);
+                        std::lock_guard lock(run->results_mutex);
+                        run->slice_results.emplace_back(from, std::move(result));
+                    } catch (...) {
+                        std::lock_guard lock(run->results_mutex);
+                        if (!run->error) {
+                            run->error = std::current_exception();
+                        }
+                        run->failed = true;
+                    }
+                }
+                run->remaining -= slice_end - from;
+                from = slice_end;
+            }
+        }
+
+        const SliceTask& slice_task;
+        ThreadPool& pool = default_thread_pool();
+        std::mutex results_mutex;
+        std::vector<std::pair<size_t, Result>> slice_results;
+        std::exception_ptr error;
+        std::atomic<bool> failed = false;
+        std::atomic<size_t> remaining;
+    };
+
+    auto run = std::make_shared<SliceRun>(slice_task, size);
+    SliceRun::process(run, 0, size);
+    run->pool.wait_until([&run] {
+        return run->remaining == 0;
+    });
+    if (run->error) {
+        std::rethrow_exception(run->error);
+    }
+
+    auto& slice_results = run->slice_results;
+    std::sort(slice_results.begin(), slice_results.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+    std::vector<Result> results;
+    results.reserve(slice_results.size());
+    for (auto& slice_result: slice_results) {
+        results.push_back(std::move(slice_result.second));
+    }
+    return results;
+}
+
+template <typename T, typename Operation>
+struct ParReduceParam {
+    ParReduceParam(T init, Operation operation): init(std::move(init)), operation(std::move(operation)) {}
+    T init;
+    Operation operation;
+};
+
+template <typename Function>
+struct ParForEachParam {
+    ParForEachParam(Function function): function(std::move(function)) {}
+    Function function;
+};
+
+struct ParToVectorParam {};
+
+template <typename T, typename Operation>
+ParReduceParam<T, Operation> par_reduce(T init, Operation operation) {
+    return {std::move(init), std::move(operation)};
+}
+
+template <typename Function>
+ParForEachParam<Function> par_for_each(Function function) {
+    return {std::move(function)};
+}
+
+ParToVectorParam par_to_vector() {
+    return {};
+}
+
+// As with std::reduce, the operation must be associative, and it is applied to partial results as well as elements.
+template <typename Container, typename T, typename Operation>
+T operator|(const Container& container, ParReduceParam<T, Operation> par_reduce_param) {
+    static_assert(IsSliceable<Container>);
+
+    auto partials = run_in_slices(slice_extent_of(container), [&container, &par_reduce_param](size_t from, size_t to) {
+        std::optional<T> partial;
+        push_slice_elements(container, from, to, [&partial, &par_reduce_param](auto&& element) {
+            if (partial) {
+                partial = par_reduce_param.operation(std::move(*partial), element);
+            } else {
+                partial = static_cast<T>(element);
+            }
+            return true;
+        });
+        return partial;
+    });
+
+    T result = std::move(par_reduce_param.init);
+    for (auto& partial: partials) {
+        if (partial) {
+            result = par_reduce_param.operation(std::move(result), std::move(*partial));
+        }
+    }
+    return result;
+}
+
+template <typename Container, typename Function>
+void operator|(const Container& container, ParForEachParam<Function> par_for_each_param) {
+    static_assert(IsSliceable<Container>);
+
+    run_in_slices(slice_extent_of(container), [&container, &par_for_each_param](size_t from, size_t to) {
+        return push_slice_elements(container, from, to, [&par_for_each_param](auto&& element) {
+            par_for_each_param.function(element);
+            return true;
+        });
+    });
+}
+
+template <typename Container>
+auto operator|(const Container& container, ParToVectorParam) {
+    static_assert(IsSliceable<Container>);
+
+    using value_type = std::iter_value_t<typename Container::const_iterator>;
+    size_t size = slice_extent_of(container);
+
+    std::vector<value_type> result;
+    if constexpr (std::random_access_iterator<typename Container::const_iterator> &&
+                  std::is_default_constructible_v<value_type>) {
+        using difference_type = std::iter_difference_t<typename Container::const_iterator>;
+        auto first = container.begin();
+        result.resize(size);
+        run_in_slices(size, [&first, &result](size_t from, size_t to) {
+            std::copy(first + static_cast<difference_type>(from), first + static_cast<difference_type>(to),
+                      result.begin() + static_cast<difference_type>(from));
+            return true;
+        });
+    } else {
+        auto parts = run_in_slices(size, [&container](size_t from, size_t to) {
+            std::vector<value_type> part;
+            push_slice_elements(container, from, to, [&part](auto&& element) {
+                part.emplace_back(std::forward<decltype(element)>(element));
+                return true;
+            });
+            return part;
+        });
+        size_t total_size = 0;
+        for (auto& part: parts) {
+            total_size += part.size();
+        }
+        result.reserve(total_size);
+        for (auto& part: parts) {
+            std::move(part.begin(), part.end(), std::back_inserter(result));
+        }
+    }
+    return result;
+}
+
+struct IncrementalParam {};
+
+// Pipelines a cursor can resume: stages that map source elements one by one (filter, transform, keys, values, cache1)
+// over a vector, deque or string. Take, drop and reverse are left out, since their positions shift when the source
+// grows, and so are sources that can grow in the middle and const sources, which cannot grow at all.
+template <typename Container>
+constexpr bool is_append_stable = false;
+
+template <typename T, typename Allocator>
+constexpr bool is_append_stable<std::vector<T, Allocator>> = true;
+
+template <typename T, typename Allocator>
+constexpr bool is_append_stable<std::deque<T, Allocator>> = true;
+
+template <typename Char, typename Traits, typename Allocator>
+constexpr bool is_append_stable<std::basic_string<Char, Traits, Allocator>> = true;
+
+template <typename Container>
+constexpr bool is_append_stable<RefView<Container>> = is_append_stable<Container>;
+
+template <typename Container>
+constexpr bool is_append_stable<OwningView<Container>> = is_append_stable<Container>;
+
+template <typename Container, typename Condition>
+constexpr bool is_append_stable<FilterView<Container, Condition>> = is_append_stable<Container>;
+
+template <typename Container, typename Transform>
+constexpr bool is_append_stable<TransformView<Container, Transform>> = is_append_stable<Container>;
+
+template <typename Container>
+constexpr bool is_append_stable<KeysView<Container>> = is_append_stable<Container>;
+
+template <typename Container>
+constexpr bool is_append_stable<ValueView<Container>> = is_append_stable<Container>;
+
+template <typename Container>
+constexpr bool is_append_stable<Cache1View<Container>> = is_append_stable<Container>;
+
+template <typename Container>
+concept IsIncremental = is_append_stable<Container> && IsSliceable<Container>;
+
+// Resumable pass over a pipeline whose source only grows, such as a vector or deque that is appended to between
+// polls. The cursor keeps an index into the source rather than an iterator, so poll() picks up where the previous
+// call stopped even after the source reallocated.
+template <typename Container>
+class IncrementalCursor {
+public:
+    static_assert(IsIncremental<Container>);
+
+    explicit IncrementalCursor(StoredContainer<Container> container):
+            container_(std::forward<StoredContainer<Container>>(container)) {}
+
+    // Passes the results of the source elements appended since the last poll to the function and returns how many
+    // there were. The source must not be modified until poll() returns.
+    template <typename Function>
+    size_t poll(Function&& function) {
+        size_t extent = slice_extent_of(container_);
+        if (extent <= position_) {
+            return 0;
+        }
+        size_t produced = 0;
+        push_slice_elements(container_, position_, extent, [&function, &produced](auto&& element) {
+            function(element);
+            ++produced;
+            return true;
+        });
+        position_ = extent;
+        return produced;
+    }
+
+    // Index into the source of the first element the next poll() reads.
+    size_t position() const {
+        return position_;
+    }
+
+    // Source elements appended since the last poll, before any stage filters them out.
+    size_t pending_source_elements() const {
+        size_t extent = slice_extent_of(container_);
+        return extent > position_ ? extent - position_ : 0;
+    }
+
+private:
+    StoredContainer<Container> container_;
+    size_t position_ = 0;
+};
+
+IncrementalParam incremental() {
+    return {};
+}
+
+template <typename Container>
+    requires IsIncremental<ViewedContainer<Container>>
+auto operator|(Container&& container, IncrementalParam) {
+    return IncrementalCursor<ViewedContainer<Container>>(as_stored(std::forward<Container>(container)));
+}
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <compare>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Sorted associative container stored as two parallel arrays, one of keys and one of values. Lookups are binary
+// searches; insertions and erasures shift the tails like in a vector, so it is meant to be built once and scanned
+// often. keys() and values() are contiguous spans, and `| keys()` / `| values()` over a FlatMap return them, which
+// lets the SIMD filter and the parallel terminals run over the keys or values directly.
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class FlatMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using key_compare = Compare;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::pair<Key, Value>;
+        using reference = std::pair<const Key&, const Value&>;
+
+        const_iterator() = default;
+
+        explicit const_iterator(const Key* key, const Value* value): key_(key), value_(value) {}
+
+        reference operator*() const {
+            return {*key_, *value_};
+        }
+
+        const_iterator& operator++() {
+            ++key_;
+            ++value_;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+
+        const_iterator& operator--() {
+            --key_;
+            --value_;
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator temp = *this;
+            --(*this);
+            return temp;
+        }
+
+        const_iterator& operator+=(difference_type n) {
+            key_ += n;
+            value_ += n;
+            return *this;
+        }
+
+        const_iterator& operator-=(difference_type n) {
+            return *this += -n;
+        }
+
+        const_iterator operator+(difference_type n) const {
+            const_iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend const_iterator operator+(difference_type n, const const_iterator& it) {
+            return it + n;
+        }
+
+        const_iterator operator-(difference_type n) const {
+            const_iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const const_iterator& other) const {
+            return key_ - other.key_;
+        }
+
+        reference operator[](difference_type n) const {
+            return *(*this + n);
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return key_ == other.key_;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+
+        auto operator<=>(const const_iterator& other) const {
+            return key_ <=> other.key_;
+        }
+
+        const Key& key() const {
+            return *key_;
+        }
+
+        const Value& value() const {
+            return *value_;
+        }
+
+    private:
+        const Key* key_ = nullptr;
+        const Value* value_ = nullptr;
+    };
+
+    using iterator = const_iterator;
+
+    FlatMap() = default;
+
+    explicit FlatMap(Compare compare): compare_(std::move(compare)) {}
+
+    template <typename Iterator>
+    FlatMap(Iterator first, Iterator last, Compare compare = Compare()): compare_(std::move(compare)) {
+        assign(first, last);
+    }
+
+    FlatMap(std::initializer_list<value_type> elements, Compare compare = Compare()):
+            FlatMap(elements.begin(), elements.end(), std::move(compare)) {}
+
+    // Sorts the elements once instead of inserting them one by one. Of several equal keys the first one is kept,
+    // as std::map::insert does.
+    template <typename Iterator>
+    void assign(Iterator first, Iterator last) {
+        std::vector<value_type> elements(first, last);
+        std::stable_sort(elements.begin(), elements.end(), [this](const value_type& a, const value_type& b) {
+            return compare_(a.first, b.first);
+        });
+
+        keys_.clear();
+        values_.clear();
+        keys_.reserve(elements.size());
+        values_.reserve(elements.size());
+        for (auto& element: elements) {
+            if (!keys_.empty() && !compare_(keys_.back(), element.first)) {
+                continue;
+            }
+            keys_.push_back(std::move(element.first));
+            values_.push_back(std::move(element.second));
+        }
+    }
+
+    const_iterator begin() const {
+        return const_iterator(keys_.data(), values_.data());
+    }
+
+    const_iterator end() const {
+        return const_iterator(keys_.data() + keys_.size(), values_.data() + values_.size());
+    }
+
+    std::reverse_iterator<const_iterator> rbegin() const {
+        return std::reverse_iterator(end());
+    }
+
+    std::reverse_iterator<const_iterator> rend() const {
+        return std::reverse_iterator(begin());
+    }
+
+    size_t size() const {
+        return keys_.size();
+    }
+
+    bool empty() const {
+        return keys_.empty();
+    }
+
+    void clear() {
+        keys_.clear();
+        values_.clear();
+    }
+
+    void reserve(size_t n) {
+        keys_.reserve(n);
+        values_.reserve(n);
+    }
+
+    std::span<const Key> keys() const {
+        return keys_;
+    }
+
+    std::span<const Value> values() const {
+        return values_;
+    }
+
+    std::span<Value> values() {
+        return values_;
+    }
+
+    const_iterator lower_bound(const Key& key) const {
+        return begin() + lower_index(key);
+    }
+
+    const_iterator upper_bound(const Key& key) const {
+        return begin() + (std::upper_bound(keys_.begin(), keys_.end(), key, compare_) - keys_.begin());
+    }
+
+    const_iterator find(const Key& key) const {
+        size_t index = lower_index(key);
+        return index != keys_.size() && !compare_(key, keys_[index]) ? begin() + index : end();
+    }
+
+    bool contains(const Key& key) const {
+        return find(key) != end();
+    }
+
+    size_t count(const Key& key) const {
+        return contains(key) ? 1 : 0;
+    }
+
+    const Value& at(const Key& key) const {
+        size_t index = lower_index(key);
+        if (index == keys_.size() || compare_(key, keys_[index])) {
+            throw std::out_of_range("FlatMap::at: no such key");
+        }
+        return values_[index];
+    }
+
+    Value& at(const Key& key) {
+        return const_cast<Value&>(std::as_const(*this).at(key));
+    }
+
+    Value& operator[](const Key& key) {
+        auto position = emplace(key, Value()).first;
+        return values_[position - begin()];
+    }
+
+    // Appending keys in increasing order costs O(1) per element; any other position shifts the tail.
+    template <typename K, typename V>
+    std::pair<const_iterator, bool> emplace(K&& key, V&& value) {
+        size_t index = keys_.empty() || compare_(keys_.back(), key) ? keys_.size() : lower_index(key);
+        if (index != keys_.size() && !compare_(key, keys_[index])) {
+            return {begin() + index, false};
+        }
+        keys_.insert(keys_.begin() + index, std::forward<K>(key));
+        values_.insert(values_.begin() + index, std::forward<V>(value));
+        return {begin() + index, true};
+    }
+
+    std::pair<const_iterator, bool> insert(value_type element) {
+        return emplace(std::move(element.first), std::move(element.second));
+    }
+
+    const_iterator erase(const_iterator position) {
+        size_t index = position - begin();
+        keys_.erase(keys_.begin() + index);
+        values_.erase(values_.begin() + index);
+        return begin() + index;
+    }
+
+    size_t erase(const Key& key) {
+        auto position = find(key);
+        if (position == end()) {
+            return 0;
+        }
+        erase(position);
+        return 1;
+    }
+
+    const Compare& key_comp() const {
+        return compare_;
+    }
+
+    bool operator==(const FlatMap& other) const {
+        return keys_ == other.keys_ && values_ == other.values_;
+    }
+
+private:
+    size_t lower_index(const Key& key) const {
+        return std::lower_bound(keys_.begin(), keys_.end(), key, compare_) - keys_.begin();
+    }
+
+    std::vector<Key> keys_;
+    std::vector<Value> values_;
+    [[no_unique_address]] Compare compare_;
+};
+
+template <typename T>
+constexpr bool is_flat_map = false;
+
+template <typename Key, typename Value, typename Compare>
+constexpr bool is_flat_map<FlatMap<Key, Value, Compare>> = true;
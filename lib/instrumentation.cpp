@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ADAPTERS_TSC
+#include <x86intrin.h>
+#endif
+
+// Per-stage counters of the views. Compiled in only with ADAPTERS_INSTRUMENTATION defined; without it the probes
+// the views carry are empty, take no space and every counting call compiles to nothing.
+
+uint64_t read_ticks() {
+#ifdef ADAPTERS_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct StageCounters {
+    std::atomic<uint64_t> increments = 0;
+    std::atomic<uint64_t> decrements = 0;
+    std::atomic<uint64_t> dereferences = 0;
+    std::atomic<uint64_t> calls = 0;
+    std::atomic<uint64_t> copies = 0;
+    std::atomic<uint64_t> sampled_calls = 0;
+    std::atomic<uint64_t> sampled_ticks = 0;
+};
+
+struct StageSample {
+    std::atomic<uint64_t> start = 0;
+    std::atomic<uint64_t> ticks = 0;
+};
+
+// One record per view type, so every pipeline built at the same place adds to the same counters.
+struct StageRecord {
+    static constexpr size_t samples_count = 1024;
+
+    std::string name;
+    std::string kind;
+    StageCounters counters;
+    std::array<StageSample, samples_count> samples;
+    std::atomic<uint64_t> next_sample = 0;
+};
+
+struct StageReport {
+    std::string name;
+    std::string kind;
+    uint64_t increments = 0;
+    uint64_t decrements = 0;
+    uint64_t dereferences = 0;
+    uint64_t calls = 0;
+    uint64_t copies = 0;
+    uint64_t sampled_calls = 0;
+    // Time in the stage's condition or function, extrapolated from the sampled calls to all of them.
+    std::chrono::nanoseconds estimated_time {0};
+};
+
+class InstrumentationRegistry {
+public:
+    InstrumentationRegistry():
+            origin_ticks_(read_ticks()), origin_time_(std::chrono::steady_clock::now()) {}
+
+    StageRecord& add(const char* kind) {
+        std::lock_guard lock(mutex_);
+        auto record = std::make_unique<StageRecord>();
+        record->kind = kind;
+        record->name = record->kind + "#" + std::to_string(records_.size());
+        records_.push_back(std::move(record));
+        return *records_.back();
+    }
+
+    std::vector<const StageRecord*> records() const {
+        std::lock_guard lock(mutex_);
+        std::vector<const StageRecord*> result;
+        for (const auto& record: records_) {
+            result.push_back(record.get());
+        }
+        return result;
+    }
+
+    void reset() {
+        std::lock_guard lock(mutex_);
+        for (auto& record: records_) {
+            StageCounters& counters = record->counters;
+            for (auto* counter: {&counters.increments, &counters.decrements, &counters.dereferences, &counters.calls,
+                                 &counters.copies, &counters.sampled_calls, &counters.sampled_ticks}) {
+                counter->store(0, std::memory_order_relaxed);
+            }
+            record->next_sample.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint32_t>& sampling_period() {
+        return sampling_period_;
+    }
+
+    uint64_t origin_ticks() const {
+        return origin_ticks_;
+    }
+
+    // Ticks of read_ticks() per nanosecond, measured against steady_clock since the registry was created.
+    double ticks_per_nanosecond() const {
+#ifdef ADAPTERS_TSC
+        auto elapsed = std::chrono::steady_clock::now() - origin_time_;
+        if (elapsed < std::chrono::milliseconds(10)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10) - elapsed);
+        }
+        uint64_t ticks = read_ticks() - origin_ticks_;
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - origin_time_).count();
+        return static_cast<double>(ticks) / static_cast<double>(std::max<int64_t>(nanoseconds, 1));
+#else
+        return 1.0;
+#endif
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<StageRecord>> records_;
+    std::atomic<uint32_t> sampling_period_ = 0;
+    uint64_t origin_ticks_;
+    std::chrono::steady_clock::time_point origin_time_;
+};
+
+InstrumentationRegistry& instrumentation_registry() {
+    static InstrumentationRegistry registry;
+    return registry;
+}
+
+// Times every period-th call of a condition or function; 0 turns timing off.
+void set_instrumentation_sampling(uint32_t period) {
+    instrumentation_registry().sampling_period().store(period, std::memory_order_relaxed);
+}
+
+void reset_instrumentation() {
+    instrumentation_registry().reset();
+}
+
+#ifdef ADAPTERS_INSTRUMENTATION
+template <typename View>
+class StageProbe {
+public:
+    StageProbe() = default;
+
+    explicit StageProbe(StageRecord& record): record_(&record) {}
+
+    StageProbe(const StageProbe& other): record_(other.record_) {
+        count(&StageCounters::copies);
+    }
+
+    StageProbe& operator=(const StageProbe& other) {
+        record_ = other.record_;
+        count(&StageCounters::copies);
+        return *this;
+    }
+
+    void increment() const {
+        count(&StageCounters::increments);
+    }
+
+    void decrement() const {
+        count(&StageCounters::decrements);
+    }
+
+    void dereference() const {
+        count(&StageCounters::dereferences);
+    }
+
+    // A seek by n counts as n increments, or -n decrements, as if the iterator had stepped there.
+    void seek(std::ptrdiff_t n) const {
+        if (n >= 0) {
+            count(&StageCounters::increments, static_cast<uint64_t>(n));
+        } else {
+            count(&StageCounters::decrements, static_cast<uint64_t>(-n));
+        }
+    }
+
+    template <typename Function, typename... Args>
+    decltype(auto) call(Function& function, Args&&... args) const {
+        if (record_ == nullptr) {
+            return std::invoke(function, std::forward<Args>(args)...);
+        }
+        uint64_t call_index = record_->counters.calls.fetch_add(1, std::memory_order_relaxed);
+        uint32_t period = instrumentation_registry().sampling_period().load(std::memory_order_relaxed);
+        if (period == 0 || call_index % period != 0) {
+            return std::invoke(function, std::forward<Args>(args)...);
+        }
+        SampleTimer timer(*record_);
+        return std::invoke(function, std::forward<Args>(args)...);
+    }
+
+private:
+    class SampleTimer {
+    public:
+        explicit SampleTimer(StageRecord& record): record_(record), start_(read_ticks()) {}
+
+        SampleTimer(const SampleTimer&) = delete;
+        SampleTimer& operator=(const SampleTimer&) = delete;
+
+        ~SampleTimer() {
+            uint64_t ticks = read_ticks() - start_;
+            record_.counters.sampled_calls.fetch_add(1, std::memory_order_relaxed);
+            record_.counters.sampled_ticks.fetch_add(ticks, std::memory_order_relaxed);
+            uint64_t index = record_.next_sample.fetch_add(1, std::memory_order_relaxed);
+            if (index < StageRecord::samples_count) {
+                record_.samples[index].start.store(start_, std::memory_order_relaxed);
+                record_.samples[index].ticks.store(ticks, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        StageRecord& record_;
+        uint64_t start_;
+    };
+
+    void count(std::atomic<uint64_t> StageCounters::* counter, uint64_t amount = 1) const {
+        if (record_ != nullptr) {
+            (record_->counters.*counter).fetch_add(amount, std::memory_order_relaxed);
+        }
+    }
+
+    StageRecord* record_ = nullptr;
+};
+
+template <typename View>
+StageProbe<View> make_stage_probe(const char* kind) {
+    static StageRecord& record = instrumentation_registry().add(kind);
+    return StageProbe<View>(record);
+}
+#else
+// Templated on the view so that the empty probes of nested stages are distinct types and can all share an address.
+template <typename View>
+class StageProbe {
+public:
+    void increment() const {}
+
+    void decrement() const {}
+
+    void dereference() const {}
+
+    void seek(std::ptrdiff_t) const {}
+
+    template <typename Function, typename... Args>
+    decltype(auto) call(Function& function, Args&&... args) const {
+        return std::invoke(function, std::forward<Args>(args)...);
+    }
+};
+
+template <typename View>
+StageProbe<View> make_stage_probe(const char*) {
+    return {};
+}
+#endif
+
+// Stages with no activity since the last reset are left out.
+std::vector<StageReport> instrumentation_report() {
+    InstrumentationRegistry& registry = instrumentation_registry();
+    std::vector<StageReport> result;
+    double ticks_per_nanosecond = 0;
+    for (const StageRecord* record: registry.records()) {
+        const StageCounters& counters = record->counters;
+        StageReport report {record->name,
+                            record->kind,
+                            counters.increments.load(std::memory_order_relaxed),
+                            counters.decrements.load(std::memory_order_relaxed),
+                            counters.dereferences.load(std::memory_order_relaxed),
+                            counters.calls.load(std::memory_order_relaxed),
+                            counters.copies.load(std::memory_order_relaxed),
+                            counters.sampled_calls.load(std::memory_order_relaxed)};
+        if (report.increments + report.decrements + report.dereferences + report.calls + report.copies == 0) {
+            continue;
+        }
+        if (report.sampled_calls != 0) {
+            if (ticks_per_nanosecond == 0) {
+                ticks_per_nanosecond = registry.ticks_per_nanosecond();
+            }
+            double sampled_nanoseconds = counters.sampled_ticks.load(std::memory_order_relaxed) / ticks_per_nanosecond;
+            report.estimated_time = std::chrono::nanoseconds(static_cast<int64_t>(
+                    sampled_nanoseconds * static_cast<double>(report.calls) / static_cast<double>(report.sampled_calls)));
+        }
+        result.push_back(std::move(report));
+    }
+    return result;
+}
+
+void print_instrumentation_report(std::ostream& out) {
+    out << std::left << std::setw(20) << "stage" << std::right << std::setw(14) << "increments" << std::setw(14)
+        << "decrements" << std::setw(14) << "dereferences" << std::setw(14) << "calls" << std::setw(10) << "copies"
+        << std::setw(14) << "time, ns" << "\n";
+    for (const StageReport& report: instrumentation_report()) {
+        out << std::left << std::setw(20) << report.name << std::right << std::setw(14) << report.increments
+            << std::setw(14) << report.decrements << std::setw(14) << report.dereferences << std::setw(14)
+            << report.calls << std::setw(10) << report.copies << std::setw(14);
+        if (report.sampled_calls != 0) {
+            out << report.estimated_time.count();
+        } else {
+            out << "-";
+        }
+        out << "\n";
+    }
+}
+
+// Chrome trace event format (chrome://tracing, Perfetto): every stage is a track of its sampled calls, and its
+// counters are attached to a counter event at the end of the trace.
+void write_chrome_trace(std::ostream& out) {
+    InstrumentationRegistry& registry = instrumentation_registry();
+    double ticks_per_microsecond = registry.ticks_per_nanosecond() * 1000;
+    auto to_microseconds = [&](uint64_t ticks) {
+        return static_cast<double>(ticks) / ticks_per_microsecond;
+    };
+
+    auto records = registry.records();
+    double trace_end = 0;
+    bool first_event = true;
+    auto begin_event = [&out, &first_event] {
+        out << (first_event ? "\n" : ",\n");
+        first_event = false;
+    };
+
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "{\"traceEvents\":[" << std::fixed << std::setprecision(3);
+    for (size_t track = 0; track < records.size(); ++track) {
+        const StageRecord& record = *records[track];
+        begin_event();
+        out << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << track << R"(,"args":{"name":")" << record.name
+            << "\"}}";
+
+        size_t samples = std::min<uint64_t>(record.next_sample.load(std::memory_order_relaxed),
+                                            StageRecord::samples_count);
+        for (size_t i = 0; i < samples; ++i) {
+            uint64_t start = record.samples[i].start.load(std::memory_order_relaxed);
+            uint64_t ticks = record.samples[i].ticks.load(std::memory_order_relaxed);
+            double timestamp = to_microseconds(start - registry.origin_ticks());
+            trace_end = std::max(trace_end, timestamp + to_microseconds(ticks));
+            begin_event();
+            out << R"({"name":")" << record.kind << R"(","ph":"X","pid":0,"tid":)" << track << R"(,"ts":)"
+                << timestamp << R"(,"dur":)" << to_microseconds(ticks) << "}";
+        }
+    }
+
+    for (const StageReport& report: instrumentation_report()) {
+        begin_event();
+        out << R"({"name":")" << report.name << R"(","ph":"C","pid":0,"ts":)" << trace_end << R"(,"args":{)"
+            << R"("increments":)" << report.increments << R"(,"decrements":)" << report.decrements
+            << R"(,"dereferences":)" << report.dereferences << R"(,"calls":)" << report.calls << R"(,"copies":)"
+            << report.copies << "}}";
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
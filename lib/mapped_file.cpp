@@ -0,0 +1,204 @@
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ADAPTERS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef ADAPTERS_MMAP
+// Read-only mapping of a whole file. Views share it, and it is unmapped together with the last of them.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor == -1) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+
+        struct stat status {};
+        if (::fstat(descriptor, &status) == -1) {
+            int error = errno;
+            ::close(descriptor);
+            throw std::system_error(error, std::generic_category(), "fstat " + path);
+        }
+
+        size_ = static_cast<size_t>(status.st_size);
+        if (size_ != 0) {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (data == MAP_FAILED) {
+                int error = errno;
+                ::close(descriptor);
+                throw std::system_error(error, std::generic_category(), "mmap " + path);
+            }
+            ::madvise(data, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(data);
+        }
+        ::close(descriptor);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    const char* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Lines of a mapped file as string_views into the mapping, without the '\n'. A last line without '\n' is still
+// yielded; an empty file has no lines.
+class MappedLinesView {
+public:
+    explicit MappedLinesView(std::shared_ptr<const MappedFile> file): file_(std::move(file)) {}
+
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::string_view;
+        using reference = std::string_view;
+
+        iterator() = default;
+
+        explicit iterator(const char* line, const char* file_end):
+                line_(line), line_end_(find_line_end(line, file_end)), file_end_(file_end) {}
+
+        reference operator*() const {
+            return {line_, static_cast<size_t>(line_end_ - line_)};
+        }
+
+        iterator& operator++() {
+            line_ = line_end_ == file_end_ ? file_end_ : line_end_ + 1;
+            line_end_ = find_line_end(line_, file_end_);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return line_ == other.line_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        static const char* find_line_end(const char* line, const char* file_end) {
+            if (line == file_end) {
+                return file_end;
+            }
+            auto line_end = static_cast<const char*>(std::memchr(line, '\n', file_end - line));
+            return line_end == nullptr ? file_end : line_end;
+        }
+
+        const char* line_ = nullptr;
+        const char* line_end_ = nullptr;
+        const char* file_end_ = nullptr;
+    };
+
+    iterator begin() const {
+        return iterator(file_->data(), file_->data() + file_->size());
+    }
+
+    iterator end() const {
+        const char* file_end = file_->data() + file_->size();
+        return iterator(file_end, file_end);
+    }
+
+    template <typename Consumer>
+    bool push_each(Consumer&& consumer) const {
+        const char* line = file_->data();
+        const char* file_end = line + file_->size();
+        while (line != file_end) {
+            auto line_end = static_cast<const char*>(std::memchr(line, '\n', file_end - line));
+            if (line_end == nullptr) {
+                return consumer(std::string_view(line, file_end - line));
+            }
+            if (!consumer(std::string_view(line, line_end - line))) {
+                return false;
+            }
+            line = line_end + 1;
+        }
+        return true;
+    }
+
+private:
+    std::shared_ptr<const MappedFile> file_;
+
+public:
+    using const_iterator = iterator;
+};
+
+// Fixed-size records read in place from a mapped file; trailing bytes that do not fill a record are ignored.
+// Iterators are contiguous, so drop/take are pointer arithmetic and the view can be split by parallel terminals.
+template <typename T>
+class MappedRecordsView {
+public:
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    explicit MappedRecordsView(std::shared_ptr<const MappedFile> file):
+            file_(std::move(file)),
+            records_(reinterpret_cast<const T*>(file_->data()), file_->size() / sizeof(T)) {}
+
+    auto begin() const {
+        return records_.begin();
+    }
+
+    auto end() const {
+        return records_.end();
+    }
+
+    size_t size() const {
+        return records_.size();
+    }
+
+    bool empty() const {
+        return records_.empty();
+    }
+
+private:
+    std::shared_ptr<const MappedFile> file_;
+    std::span<const T> records_;
+
+public:
+    using const_iterator = std::span<const T>::iterator;
+};
+
+MappedLinesView mmap_lines(const std::string& path) {
+    return MappedLinesView(std::make_shared<const MappedFile>(path));
+}
+
+template <typename T>
+MappedRecordsView<T> mmap_records(const std::string& path) {
+    return MappedRecordsView<T>(std::make_shared<const MappedFile>(path));
+}
+#endif
@@ -0,0 +1,535 @@
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+// Balanced search tree (a treap) whose nodes also store the size of their subtree. Besides the usual ordered lookups
+// this gives the position of an element and the element at a position in O(log n), so its iterators jump with +=
+// and measure distances with - in O(log n). DropView and TakeView use these operations on any such iterator, which
+// makes drop(n) and take(n) over IndexedSet and IndexedMap cost O(log n) whatever n is.
+// As in std::set, the root hangs off a header node inside the tree that also serves as end(). Iterators only follow
+// node links, so iterators to elements stay valid when the tree is moved; end() iterators are those of the old object.
+template <typename Element, typename Key, typename KeyOf, typename Compare>
+class OrderStatisticTree {
+    // The header is the only node without a parent; its left child is the root and its size stays 0.
+    struct NodeBase {
+        NodeBase* left = nullptr;
+        NodeBase* right = nullptr;
+        NodeBase* parent = nullptr;
+        size_t size = 0;
+    };
+
+    struct Node : NodeBase {
+        template <typename... Args>
+        explicit Node(uint64_t priority, Args&&... args): element(std::forward<Args>(args)...), priority(priority) {
+            this->size = 1;
+        }
+
+        Element element;
+        uint64_t priority;
+    };
+
+public:
+    using key_type = Key;
+    using value_type = Element;
+    using key_compare = Compare;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Element;
+        using reference = const Element&;
+        using pointer = const Element*;
+
+        const_iterator() = default;
+
+        explicit const_iterator(const NodeBase* node): node_(node) {}
+
+        reference operator*() const {
+            return static_cast<const Node*>(node_)->element;
+        }
+
+        pointer operator->() const {
+            return &static_cast<const Node*>(node_)->element;
+        }
+
+        const_iterator& operator++() {
+            node_ = successor(node_);
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+
+        const_iterator& operator--() {
+            node_ = is_header(node_) ? rightmost(node_->left) : predecessor(node_);
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator temp = *this;
+            --(*this);
+            return temp;
+        }
+
+        const_iterator& operator+=(difference_type n) {
+            if (n != 0) {
+                node_ = select(header_of(node_), rank(node_) + n);
+            }
+            return *this;
+        }
+
+        const_iterator& operator-=(difference_type n) {
+            return *this += -n;
+        }
+
+        const_iterator operator+(difference_type n) const {
+            const_iterator temp = *this;
+            temp += n;
+            return temp;
+        }
+
+        friend const_iterator operator+(difference_type n, const const_iterator& it) {
+            return it + n;
+        }
+
+        const_iterator operator-(difference_type n) const {
+            const_iterator temp = *this;
+            temp -= n;
+            return temp;
+        }
+
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(rank(node_)) - static_cast<difference_type>(rank(other.node_));
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return node_ == other.node_;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class OrderStatisticTree;
+
+        const NodeBase* node_ = nullptr;
+    };
+
+    using iterator = const_iterator;
+
+    OrderStatisticTree() = default;
+
+    explicit OrderStatisticTree(Compare compare): compare_(std::move(compare)) {}
+
+    OrderStatisticTree(const OrderStatisticTree& other): compare_(other.compare_), next_priority_(other.next_priority_) {
+        header_.left = clone(other.header_.left, &header_);
+    }
+
+    OrderStatisticTree(OrderStatisticTree&& other) noexcept:
+            compare_(std::move(other.compare_)), next_priority_(other.next_priority_) {
+        adopt_root(std::exchange(other.header_.left, nullptr));
+    }
+
+    OrderStatisticTree& operator=(OrderStatisticTree other) noexcept {
+        NodeBase* root = header_.left;
+        adopt_root(other.header_.left);
+        other.adopt_root(root);
+        std::swap(compare_, other.compare_);
+        std::swap(next_priority_, other.next_priority_);
+        return *this;
+    }
+
+    ~OrderStatisticTree() {
+        destroy(header_.left);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(empty() ? &header_ : leftmost(header_.left));
+    }
+
+    const_iterator end() const {
+        return const_iterator(&header_);
+    }
+
+    size_t size() const {
+        return size_of(header_.left);
+    }
+
+    bool empty() const {
+        return header_.left == nullptr;
+    }
+
+    void clear() {
+        destroy(header_.left);
+        header_.left = nullptr;
+    }
+
+    // The element at a position in key order, or end() past the last one.
+    const_iterator nth(size_t index) const {
+        return const_iterator(select(&header_, index));
+    }
+
+    // The position of an element in key order; end() is at size().
+    size_t index_of(const_iterator position) const {
+        return rank(position.node_);
+    }
+
+    const_iterator lower_bound(const Key& key) const {
+        const NodeBase* result = &header_;
+        for (const NodeBase* node = header_.left; node != nullptr;) {
+            if (compare_(key_of(node), key)) {
+                node = node->right;
+            } else {
+                result = node;
+                node = node->left;
+            }
+        }
+        return const_iterator(result);
+    }
+
+    const_iterator upper_bound(const Key& key) const {
+        const NodeBase* result = &header_;
+        for (const NodeBase* node = header_.left; node != nullptr;) {
+            if (compare_(key, key_of(node))) {
+                result = node;
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        return const_iterator(result);
+    }
+
+    const_iterator find(const Key& key) const {
+        auto position = lower_bound(key);
+        return position != end() && !compare_(key, KeyOf()(*position)) ? position : end();
+    }
+
+    bool contains(const Key& key) const {
+        return find(key) != end();
+    }
+
+    size_t count(const Key& key) const {
+        return contains(key) ? 1 : 0;
+    }
+
+    std::pair<const_iterator, bool> insert(Element element) {
+        return emplace_element(std::move(element));
+    }
+
+    const_iterator erase(const_iterator position) {
+        NodeBase* node = const_cast<NodeBase*>(position.node_);
+        const_iterator next = std::next(position);
+        while (node->left != nullptr || node->right != nullptr) {
+            bool lift_left = node->right == nullptr ||
+                             (node->left != nullptr && priority_of(node->left) > priority_of(node->right));
+            rotate_up(lift_left ? node->left : node->right);
+        }
+
+        NodeBase* parent = node->parent;
+        if (parent->left == node) {
+            parent->left = nullptr;
+        } else {
+            parent->right = nullptr;
+        }
+        for (NodeBase* ancestor = parent; ancestor != &header_; ancestor = ancestor->parent) {
+            --ancestor->size;
+        }
+        delete static_cast<Node*>(node);
+        return next;
+    }
+
+    size_t erase(const Key& key) {
+        auto position = find(key);
+        if (position == end()) {
+            return 0;
+        }
+        erase(position);
+        return 1;
+    }
+
+    const Compare& key_comp() const {
+        return compare_;
+    }
+
+protected:
+    // Inserts unless an element with an equal key is present, in which case the new element is dropped.
+    template <typename... Args>
+    std::pair<const_iterator, bool> emplace_element(Args&&... args) {
+        Node* node = new Node(next_priority(), std::forward<Args>(args)...);
+        const Key& key = key_of(node);
+
+        NodeBase* parent = &header_;
+        bool is_left = true;
+        for (NodeBase* current = header_.left; current != nullptr;) {
+            parent = current;
+            if (compare_(key, key_of(current))) {
+                is_left = true;
+                current = current->left;
+            } else if (compare_(key_of(current), key)) {
+                is_left = false;
+                current = current->right;
+            } else {
+                delete node;
+                return {const_iterator(current), false};
+            }
+        }
+
+        node->parent = parent;
+        if (is_left) {
+            parent->left = node;
+        } else {
+            parent->right = node;
+        }
+        for (NodeBase* ancestor = parent; ancestor != &header_; ancestor = ancestor->parent) {
+            ++ancestor->size;
+        }
+        while (node->parent != &header_ && priority_of(node->parent) < node->priority) {
+            rotate_up(node);
+        }
+        return {const_iterator(node), true};
+    }
+
+    static Element& element_at(const_iterator position) {
+        return const_cast<Node*>(static_cast<const Node*>(position.node_))->element;
+    }
+
+private:
+    static const Key& key_of(const NodeBase* node) {
+        return KeyOf()(static_cast<const Node*>(node)->element);
+    }
+
+    static uint64_t priority_of(const NodeBase* node) {
+        return static_cast<const Node*>(node)->priority;
+    }
+
+    static size_t size_of(const NodeBase* node) {
+        return node == nullptr ? 0 : node->size;
+    }
+
+    static bool is_header(const NodeBase* node) {
+        return node->parent == nullptr;
+    }
+
+    static const NodeBase* header_of(const NodeBase* node) {
+        while (!is_header(node)) {
+            node = node->parent;
+        }
+        return node;
+    }
+
+    static const NodeBase* leftmost(const NodeBase* node) {
+        while (node != nullptr && node->left != nullptr) {
+            node = node->left;
+        }
+        return node;
+    }
+
+    static const NodeBase* rightmost(const NodeBase* node) {
+        while (node != nullptr && node->right != nullptr) {
+            node = node->right;
+        }
+        return node;
+    }
+
+    // Past the largest element this climbs to the root and on to the header, whose right child is always null.
+    static const NodeBase* successor(const NodeBase* node) {
+        if (node->right != nullptr) {
+            return leftmost(node->right);
+        }
+        while (node->parent->right == node) {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    static const NodeBase* predecessor(const NodeBase* node) {
+        if (node->left != nullptr) {
+            return rightmost(node->left);
+        }
+        while (node->parent != nullptr && node->parent->left == node) {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    static size_t rank(const NodeBase* node) {
+        if (is_header(node)) {
+            return size_of(node->left);
+        }
+        size_t result = size_of(node->left);
+        for (; !is_header(node->parent); node = node->parent) {
+            if (node->parent->right == node) {
+                result += size_of(node->parent->left) + 1;
+            }
+        }
+        return result;
+    }
+
+    static const NodeBase* select(const NodeBase* header, size_t index) {
+        const NodeBase* node = header->left;
+        while (node != nullptr) {
+            size_t left_size = size_of(node->left);
+            if (index < left_size) {
+                node = node->left;
+            } else if (index == left_size) {
+                return node;
+            } else {
+                index -= left_size + 1;
+                node = node->right;
+            }
+        }
+        return header;
+    }
+
+    void adopt_root(NodeBase* root) {
+        header_.left = root;
+        if (root != nullptr) {
+            root->parent = &header_;
+        }
+    }
+
+    // Lifts node above its parent, keeping the key order and fixing the sizes of both.
+    void rotate_up(NodeBase* node) {
+        NodeBase* parent = node->parent;
+        NodeBase* grandparent = parent->parent;
+        if (parent->left == node) {
+            parent->left = node->right;
+            if (node->right != nullptr) {
+                node->right->parent = parent;
+            }
+            node->right = parent;
+        } else {
+            parent->right = node->left;
+            if (node->left != nullptr) {
+                node->left->parent = parent;
+            }
+            node->left = parent;
+        }
+        parent->parent = node;
+        node->parent = grandparent;
+        if (grandparent->left == parent) {
+            grandparent->left = node;
+        } else {
+            grandparent->right = node;
+        }
+        parent->size = 1 + size_of(parent->left) + size_of(parent->right);
+        node->size = 1 + size_of(node->left) + size_of(node->right);
+    }
+
+    // splitmix64 of a counter: well spread priorities without a random engine per tree.
+    uint64_t next_priority() {
+        uint64_t z = (next_priority_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    static NodeBase* clone(const NodeBase* node, NodeBase* parent) {
+        if (node == nullptr) {
+            return nullptr;
+        }
+        const Node* original = static_cast<const Node*>(node);
+        Node* copy = new Node(original->priority, original->element);
+        copy->size = original->size;
+        copy->parent = parent;
+        copy->left = clone(original->left, copy);
+        copy->right = clone(original->right, copy);
+        return copy;
+    }
+
+    static void destroy(NodeBase* node) {
+        while (node != nullptr) {
+            destroy(node->left);
+            NodeBase* right = node->right;
+            delete static_cast<Node*>(node);
+            node = right;
+        }
+    }
+
+    NodeBase header_;
+    [[no_unique_address]] Compare compare_;
+    uint64_t next_priority_ = 0;
+};
+
+struct SetKeyOf {
+    template <typename T>
+    const T& operator()(const T& element) const {
+        return element;
+    }
+};
+
+struct MapKeyOf {
+    template <typename Pair>
+    const auto& operator()(const Pair& element) const {
+        return element.first;
+    }
+};
+
+template <typename Key, typename Compare = std::less<Key>>
+class IndexedSet : public OrderStatisticTree<Key, Key, SetKeyOf, Compare> {
+    using Tree = OrderStatisticTree<Key, Key, SetKeyOf, Compare>;
+
+public:
+    using Tree::Tree;
+
+    IndexedSet(std::initializer_list<Key> elements, Compare compare = Compare()): Tree(std::move(compare)) {
+        for (const auto& element: elements) {
+            this->insert(element);
+        }
+    }
+
+    template <typename... Args>
+    std::pair<typename Tree::const_iterator, bool> emplace(Args&&... args) {
+        return this->emplace_element(std::forward<Args>(args)...);
+    }
+};
+
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class IndexedMap : public OrderStatisticTree<std::pair<const Key, Value>, Key, MapKeyOf, Compare> {
+    using Tree = OrderStatisticTree<std::pair<const Key, Value>, Key, MapKeyOf, Compare>;
+
+public:
+    using mapped_type = Value;
+    using Tree::Tree;
+
+    IndexedMap(std::initializer_list<std::pair<const Key, Value>> elements, Compare compare = Compare()):
+            Tree(std::move(compare)) {
+        for (const auto& element: elements) {
+            this->insert(element);
+        }
+    }
+
+    template <typename K, typename V>
+    std::pair<typename Tree::const_iterator, bool> emplace(K&& key, V&& value) {
+        return this->emplace_element(std::forward<K>(key), std::forward<V>(value));
+    }
+
+    const Value& at(const Key& key) const {
+        auto position = this->find(key);
+        if (position == this->end()) {
+            throw std::out_of_range("IndexedMap::at: no such key");
+        }
+        return position->second;
+    }
+
+    Value& at(const Key& key) {
+        return const_cast<Value&>(std::as_const(*this).at(key));
+    }
+
+    Value& operator[](const Key& key) {
+        auto position = this->find(key);
+        if (position == this->end()) {
+            position = emplace(key, Value()).first;
+        }
+        return Tree::element_at(position).second;
+    }
+};
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ADAPTERS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+enum class SimdLevel {
+    Scalar,
+    Sse,
+    Avx2,
+};
+
+SimdLevel detect_simd_level() {
+#ifdef ADAPTERS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return SimdLevel::Avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return SimdLevel::Sse;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+// Parallel terminals read the level from worker threads, so it may change while they run.
+std::atomic<SimdLevel>& active_simd_level() {
+    static std::atomic<SimdLevel> level = detect_simd_level();
+    return level;
+}
+
+SimdLevel simd_level() {
+    return active_simd_level().load(std::memory_order_relaxed);
+}
+
+// Lowers the kernel set used by batched filters, e.g. to compare kernels in tests and benchmarks.
+// Levels the CPU does not support are clamped to the detected one.
+void set_simd_level(SimdLevel level) {
+    active_simd_level().store(std::min(level, detect_simd_level()), std::memory_order_relaxed);
+}
+
+struct CompactionTables {
+    alignas(32) std::array<std::array<uint32_t, 8>, 256> avx2_lanes32;
+    alignas(32) std::array<std::array<uint32_t, 8>, 16> avx2_lanes64;
+    alignas(16) std::array<std::array<uint8_t, 16>, 16> sse_lanes32;
+    alignas(16) std::array<std::array<uint8_t, 16>, 4> sse_lanes64;
+    std::array<uint8_t, 16> lane_counts;
+};
+
+// For every lane mask, the indices that move the selected lanes to the front in their original order.
+constexpr CompactionTables make_compaction_tables() {
+    CompactionTables tables {};
+    for (uint32_t bits = 0; bits < 256; ++bits) {
+        uint32_t kept = 0;
+        for (uint32_t lane = 0; lane < 8; ++lane) {
+            if (bits & (1u << lane)) {
+                tables.avx2_lanes32[bits][kept++] = lane;
+            }
+        }
+    }
+    for (uint32_t bits = 0; bits < 16; ++bits) {
+        tables.lane_counts[bits] = static_cast<uint8_t>(std::popcount(bits));
+        uint32_t kept = 0;
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            if (bits & (1u << lane)) {
+                tables.avx2_lanes64[bits][2 * kept] = 2 * lane;
+                tables.avx2_lanes64[bits][2 * kept + 1] = 2 * lane + 1;
+                for (uint32_t byte = 0; byte < 4; ++byte) {
+                    tables.sse_lanes32[bits][4 * kept + byte] = static_cast<uint8_t>(4 * lane + byte);
+                }
+                ++kept;
+            }
+        }
+    }
+    for (uint32_t bits = 0; bits < 4; ++bits) {
+        uint32_t kept = 0;
+        for (uint32_t lane = 0; lane < 2; ++lane) {
+            if (bits & (1u << lane)) {
+                for (uint32_t byte = 0; byte < 8; ++byte) {
+                    tables.sse_lanes64[bits][8 * kept + byte] = static_cast<uint8_t>(8 * lane + byte);
+                }
+                ++kept;
+            }
+        }
+    }
+    return tables;
+}
+
+constexpr CompactionTables compaction_tables = make_compaction_tables();
+
+// Copies values[i] with mask[i] != 0 to the front of out and returns their number.
+// out must have room for n elements; slots past the returned count are overwritten with garbage.
+template <typename T>
+size_t compact_scalar(const T* values, const uint8_t* mask, size_t n, T* out) {
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i) {
+        out[kept] = values[i];
+        kept += (mask[i] != 0);
+    }
+    return kept;
+}
+
+#ifdef ADAPTERS_X86_SIMD
+template <typename T>
+__attribute__((target("avx2,popcnt"))) size_t compact_avx2(const T* values, const uint8_t* mask, size_t n, T* out) {
+    constexpr size_t lanes = 32 / sizeof(T);
+    size_t kept = 0;
+    size_t i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        __m128i mask_bytes;
+        if constexpr (lanes == 8) {
+            mask_bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask + i));
+        } else {
+            uint32_t word;
+            __builtin_memcpy(&word, mask + i, sizeof(word));
+            mask_bytes = _mm_cvtsi32_si128(static_cast<int>(word));
+        }
+        uint32_t bits = _mm_movemask_epi8(_mm_cmpgt_epi8(mask_bytes, _mm_setzero_si128())) & ((1u << lanes) - 1);
+
+        const uint32_t* indices = lanes == 8 ? compaction_tables.avx2_lanes32[bits].data()
+                                             : compaction_tables.avx2_lanes64[bits].data();
+        __m256i permutation = _mm256_load_si256(reinterpret_cast<const __m256i*>(indices));
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + kept), _mm256_permutevar8x32_epi32(block, permutation));
+        kept += std::popcount(bits);
+    }
+    return kept + compact_scalar(values + i, mask + i, n - i, out + kept);
+}
+
+template <typename T>
+__attribute__((target("ssse3"))) size_t compact_sse(const T* values, const uint8_t* mask, size_t n, T* out) {
+    constexpr size_t lanes = 16 / sizeof(T);
+    size_t kept = 0;
+    size_t i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        uint32_t word = 0;
+        __builtin_memcpy(&word, mask + i, lanes);
+        __m128i mask_bytes = _mm_cvtsi32_si128(static_cast<int>(word));
+        uint32_t bits = _mm_movemask_epi8(_mm_cmpgt_epi8(mask_bytes, _mm_setzero_si128())) & ((1u << lanes) - 1);
+
+        const uint8_t* shuffle = lanes == 4 ? compaction_tables.sse_lanes32[bits].data()
+                                            : compaction_tables.sse_lanes64[bits].data();
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m128i selected = _mm_shuffle_epi8(block, _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + kept), selected);
+        kept += compaction_tables.lane_counts[bits];
+    }
+    return kept + compact_scalar(values + i, mask + i, n - i, out + kept);
+}
+#endif
+
+template <typename T>
+size_t compact_selected(const T* values, const uint8_t* mask, size_t n, T* out, SimdLevel level = simd_level()) {
+    static_assert(std::is_arithmetic_v<T>);
+#ifdef ADAPTERS_X86_SIMD
+    if constexpr (sizeof(T) == 4 || sizeof(T) == 8) {
+        if (level == SimdLevel::Avx2) {
+            return compact_avx2(values, mask, n, out);
+        }
+        if (level == SimdLevel::Sse) {
+            return compact_sse(values, mask, n, out);
+        }
+    }
+#endif
+    return compact_scalar(values, mask, n, out);
+}
+
+// Batched filter over contiguous arithmetic data: the condition is evaluated over a whole batch into a mask,
+// the selected elements are compacted with the widest available kernel and only then handed to the consumer.
+// Only the compaction has SIMD kernels. The condition is an arbitrary callable and is called once per element;
+// the mask loop is left to the compiler, which can vectorize it when the condition inlines to a plain comparison.
+// Batches start small and grow, so a consumer that stops early (take) wastes at most one batch of conditions.
+template <typename T, typename Condition, typename Consumer>
+bool push_selected(const T* first, const T* last, const Condition& condition, Consumer& consumer) {
+    constexpr size_t max_batch_size = 512;
+    alignas(32) uint8_t mask[max_batch_size];
+    alignas(32) T selected[max_batch_size];
+
+    const SimdLevel level = simd_level();
+    size_t batch_size = 32;
+    while (first != last) {
+        size_t n = std::min<size_t>(batch_size, last - first);
+        for (size_t i = 0; i < n; ++i) {
+            mask[i] = static_cast<uint8_t>(static_cast<bool>(condition(first[i])));
+        }
+
+        size_t kept = compact_selected(first, mask, n, selected, level);
+        for (size_t i = 0; i < kept; ++i) {
+            if (!consumer(selected[i])) {
+                return false;
+            }
+        }
+
+        first += n;
+        batch_size = std::min(batch_size * 2, max_batch_size);
+    }
+    return true;
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+struct WorkerStatistics {
+    size_t steals = 0;
+    size_t chunks = 0;
+    std::chrono::nanoseconds idle_time {0};
+};
+
+// Work-stealing pool: every worker owns a deque, takes its own tasks from the back and steals from the front of the
+// others when it runs out. Tasks spawned from a worker go to its own deque, tasks from other threads to a shared queue.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads_count = std::max(1u, std::thread::hardware_concurrency())) {
+        for (size_t i = 0; i < threads_count; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < threads_count; ++i) {
+            workers_[i]->thread = std::thread([this, i] {
+                work(i);
+            });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(sleep_mutex_);
+            stopping_ = true;
+        }
+        has_tasks_.notify_all();
+        for (auto& worker: workers_) {
+            worker->thread.join();
+        }
+    }
+
+    size_t size() const {
+        return workers_.size();
+    }
+
+    bool has_idle_workers() const {
+        return idle_workers_.load(std::memory_order_relaxed) != 0;
+    }
+
+    void spawn(std::function<void()> task) {
+        if (current_pool_ == this) {
+            Worker& worker = *workers_[current_worker_];
+            std::lock_guard lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        } else {
+            std::lock_guard lock(shared_mutex_);
+            shared_tasks_.push_back(std::move(task));
+        }
+        pending_tasks_.fetch_add(1);
+        {
+            std::lock_guard lock(sleep_mutex_);
+        }
+        has_tasks_.notify_one();
+    }
+
+    template <typename Task>
+    std::future<std::invoke_result_t<Task&>> submit(Task task) {
+        auto packaged_task = std::make_shared<std::packaged_task<std::invoke_result_t<Task&>()>>(std::move(task));
+        auto future = packaged_task->get_future();
+        spawn([packaged_task] {
+            (*packaged_task)();
+        });
+        return future;
+    }
+
+    // Runs queued tasks on the calling thread until the future is ready, so waiting from inside a task cannot starve
+    // the pool.
+    template <typename Result>
+    void wait(const std::future<Result>& future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!run_pending_task()) {
+                future.wait_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+
+    template <typename Predicate>
+    void wait_until(const Predicate& done) {
+        while (!done()) {
+            if (!run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::vector<WorkerStatistics> statistics() const {
+        std::vector<WorkerStatistics> result;
+        for (const auto& worker: workers_) {
+            result.push_back({worker->steals.load(), worker->chunks.load(),
+                              std::chrono::nanoseconds(worker->idle_nanoseconds.load())});
+        }
+        return result;
+    }
+
+    void reset_statistics() {
+        for (auto& worker: workers_) {
+            worker->steals = 0;
+            worker->chunks = 0;
+            worker->idle_nanoseconds = 0;
+        }
+    }
+
+private:
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::atomic<size_t> steals = 0;
+        std::atomic<size_t> chunks = 0;
+        std::atomic<int64_t> idle_nanoseconds = 0;
+    };
+
+    bool take_task(size_t worker_index, std::function<void()>& task) {
+        if (worker_index < workers_.size()) {
+            Worker& worker = *workers_[worker_index];
+            std::lock_guard lock(worker.mutex);
+            if (!worker.tasks.empty()) {
+                task = std::move(worker.tasks.back());
+                worker.tasks.pop_back();
+                pending_tasks_.fetch_sub(1);
+                return true;
+            }
+        }
+        {
+            std::lock_guard lock(shared_mutex_);
+            if (!shared_tasks_.empty()) {
+                task = std::move(shared_tasks_.front());
+                shared_tasks_.pop_front();
+                pending_tasks_.fetch_sub(1);
+                return true;
+            }
+        }
+        for (size_t shift = 1; shift <= workers_.size(); ++shift) {
+            size_t victim_index = (worker_index + shift) % workers_.size();
+            if (victim_index == worker_index) {
+                continue;
+            }
+            Worker& victim = *workers_[victim_index];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                pending_tasks_.fetch_sub(1);
+                if (worker_index < workers_.size()) {
+                    ++workers_[worker_index]->steals;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool run_pending_task() {
+        size_t worker_index = current_pool_ == this ? current_worker_ : workers_.size();
+        std::function<void()> task;
+        if (!take_task(worker_index, task)) {
+            return false;
+        }
+        if (worker_index < workers_.size()) {
+            ++workers_[worker_index]->chunks;
+        }
+        task();
+        return true;
+    }
+
+    void work(size_t worker_index) {
+        current_pool_ = this;
+        current_worker_ = worker_index;
+        Worker& worker = *workers_[worker_index];
+
+        while (true) {
+            if (run_pending_task()) {
+                continue;
+            }
+
+            auto idle_start = std::chrono::steady_clock::now();
+            std::unique_lock lock(sleep_mutex_);
+            ++idle_workers_;
+            has_tasks_.wait(lock, [this] {
+                return stopping_ || pending_tasks_.load() != 0;
+            });
+            --idle_workers_;
+            bool stop = stopping_ && pending_tasks_.load() == 0;
+            lock.unlock();
+            worker.idle_nanoseconds += (std::chrono::steady_clock::now() - idle_start).count();
+
+            if (stop) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::deque<std::function<void()>> shared_tasks_;
+    std::mutex shared_mutex_;
+    std::atomic<size_t> pending_tasks_ = 0;
+    std::atomic<size_t> idle_workers_ = 0;
+    std::mutex sleep_mutex_;
+    std::condition_variable has_tasks_;
+    bool stopping_ = false;
+
+    static thread_local inline ThreadPool* current_pool_ = nullptr;
+    static thread_local inline size_t current_worker_ = 0;
+};
+
+ThreadPool& default_thread_pool() {
+    static ThreadPool pool;
+    return pool;
+}
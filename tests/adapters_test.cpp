@@ -1,6 +1,17 @@
 #include <lib/adapters.cpp>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <list>
 #include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 #include <map>
 
@@ -371,7 +382,1426 @@ TEST(adaptersTestSuite, VectorFilterTest) {
 }
 
 
+TEST(adaptersTestSuite, VectorDropTakePagingTest) {
+    std::vector<int> numbers(1'000'000);
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        numbers[i] = static_cast<int>(i);
+    }
+
+    auto dropped = drop(numbers, 999'990);
+    auto page = take(dropped, 5);
+    std::vector<int> ans {999'990, 999'991, 999'992, 999'993, 999'994};
+
+    ASSERT_EQ(page.end() - page.begin(), 5);
+    for (int pass = 0; pass < 2; ++pass) {
+        int c = 0;
+        for (auto element: page) {
+            ASSERT_EQ(element, ans[c]);
+            ++c;
+        }
+        ASSERT_EQ(c, 5);
+    }
+
+    auto dropped_tail = drop(numbers, 999'998);
+    auto tail = take(dropped_tail, 10);
+    ASSERT_EQ(tail.end() - tail.begin(), 2);
+
+    auto dropped_all = drop(numbers, 2'000'000);
+    auto nothing = take(dropped_all, 10);
+    ASSERT_TRUE(nothing.begin() == nothing.end());
+}
+
+TEST(adaptersTestSuite, ListDropTakeTest) {
+    std::list<int> numbers {1, 2, 3, 4, 5, 6, 7, 8};
+    std::vector<int> ans {3, 4, 5};
+
+    auto dropped = drop(numbers, 2);
+    auto res = take(dropped, 3);
+
+    int c = 0;
+    for (auto element: res) {
+        ASSERT_EQ(element, ans[c]);
+        ++c;
+    }
+    ASSERT_EQ(c, 3);
+
+    auto everything = numbers | take(100);
+    c = 0;
+    for (auto element: everything) {
+        ASSERT_EQ(element, c + 1);
+        ++c;
+    }
+    ASSERT_EQ(c, 8);
+}
+
+TEST(adaptersTestSuite, DropGrowingSourceTest) {
+    std::vector<int> numbers = {1, 2, 3};
+    numbers.shrink_to_fit();
+    auto dropped = numbers | drop(1);
+    ASSERT_EQ(dropped | to<std::vector<int>>(), std::vector<int>({2, 3}));
+
+    const int* storage = numbers.data();
+    for (int i = 4; i <= 100; ++i) {
+        numbers.push_back(i);
+    }
+    ASSERT_NE(numbers.data(), storage);
+
+    int c = 2;
+    for (int element: dropped) {
+        ASSERT_EQ(element, c);
+        ++c;
+    }
+    ASSERT_EQ(c, 101);
+    ASSERT_EQ(dropped.size(), 99);
+}
+
+TEST(adaptersTestSuite, HugeTakeDropCountsTest) {
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    const size_t huge_counts[] = {std::numeric_limits<size_t>::max(), size_t(1) << 63};
+
+    for (size_t n: huge_counts) {
+        auto taken = numbers | take(n);
+        ASSERT_EQ(taken.end() - taken.begin(), 10);
+        ASSERT_EQ(taken.size(), 10);
+        std::vector<int> elements;
+        for (int element: taken) {
+            elements.push_back(element);
+        }
+        ASSERT_EQ(elements, numbers);
+
+        auto dropped = numbers | drop(n);
+        ASSERT_TRUE(dropped.empty());
+        ASSERT_EQ(dropped.begin(), dropped.end());
+        size_t c = 0;
+        for (int element: dropped) {
+            ASSERT_EQ(element, 0);
+            ++c;
+        }
+        ASSERT_EQ(c, 0);
+    }
+}
+
+TEST(adaptersTestSuite, VectorRandomAccessTest) {
+    std::vector<int> numbers {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+    auto squares = numbers | transform(square);
+    static_assert(std::random_access_iterator<decltype(squares.begin())>);
+    ASSERT_EQ(std::distance(squares.begin(), squares.end()), 10);
+    ASSERT_EQ(squares.begin()[3], 16);
+    auto found = std::lower_bound(squares.begin(), squares.end(), 49);
+    ASSERT_EQ(found - squares.begin(), 6);
+    ASSERT_EQ(*found, 49);
+
+    auto reversed = numbers | reverse();
+    static_assert(std::random_access_iterator<decltype(reversed.begin())>);
+    ASSERT_EQ(reversed.begin()[0], 10);
+    ASSERT_EQ(*(reversed.end() - 1), 1);
+    ASSERT_TRUE(reversed.begin() < reversed.end());
+    auto reversed_found = std::lower_bound(reversed.begin(), reversed.end(), 4, std::greater<>());
+    ASSERT_EQ(reversed_found - reversed.begin(), 6);
+
+    auto dropped = drop(numbers, 2);
+    auto page = take(dropped, 5);
+    static_assert(std::random_access_iterator<decltype(page.begin())>);
+    ASSERT_EQ(page.begin()[4], 7);
+    ASSERT_EQ(std::distance(page.begin(), page.end()), 5);
+    ASSERT_TRUE(std::binary_search(page.begin(), page.end(), 5));
+    ASSERT_FALSE(std::binary_search(page.begin(), page.end(), 8));
+}
+
+TEST(adaptersTestSuite, KeysValuesRandomAccessTest) {
+    std::vector<std::pair<int, int>> pairs {{1, 10}, {3, 30}, {5, 50}, {7, 70}};
+    std::map<int, int> g {{1, 10}, {3, 30}};
+
+    auto keys_ = keys(pairs);
+    auto values_ = values(pairs);
+    static_assert(std::random_access_iterator<decltype(keys_.begin())>);
+    static_assert(std::random_access_iterator<decltype(values_.begin())>);
+    static_assert(std::bidirectional_iterator<decltype(keys(g).begin())>);
+    static_assert(!std::random_access_iterator<decltype(keys(g).begin())>);
+    static_assert(!std::random_access_iterator<decltype(filter(pairs, is_devided_by_twoo).begin())>);
+
+    ASSERT_EQ(*std::lower_bound(keys_.begin(), keys_.end(), 4), 5);
+    ASSERT_EQ(values_.end() - values_.begin(), 4);
+    ASSERT_EQ((values_.begin() + 2)[1], 70);
+}
+
+TEST(adaptersTestSuite, FilterBeginCacheTest) {
+    std::vector<int> numbers {1, 3, 5, 7, 8, 9, 10};
+    int calls = 0;
+    auto is_even = [&calls](int x) {
+        ++calls;
+        return x % 2 == 0;
+    };
+
+    auto res = filter(numbers, is_even);
+    ASSERT_EQ(*res.begin(), 8);
+    ASSERT_EQ(calls, 5);
+
+    ASSERT_EQ(*res.begin(), 8);
+    ASSERT_EQ(calls, 5);
+
+    numbers[1] = 4;
+    ASSERT_EQ(*res.begin(), 8);
+
+    res.refresh();
+    ASSERT_EQ(*res.begin(), 4);
+    ASSERT_EQ(calls, 7);
+}
+
+struct Record {
+    std::string name;
+    char payload[192];
+};
+
+TEST(adaptersTestSuite, ReferenceDereferenceTest) {
+    std::map<int, std::string> names {{1, "one"}, {2, "two"}, {3, "three"}};
+    auto values_ = values(names);
+    static_assert(std::is_same_v<decltype(*values_.begin()), const std::string&>);
+    static_assert(std::is_same_v<decltype(*keys(names).begin()), const int&>);
+    ASSERT_EQ(&*values_.begin(), &names.begin()->second);
+
+    std::vector<int> numbers {1, 2, 3, 4, 5};
+    auto dropped = drop(numbers, 1);
+    auto page = take(dropped, 3);
+    static_assert(std::contiguous_iterator<decltype(page.begin())>);
+    ASSERT_EQ(&*page.begin(), &numbers[1]);
+    ASSERT_EQ(std::to_address(page.end()), numbers.data() + 4);
+
+    auto even = filter(numbers, is_devided_by_twoo_int);
+    auto reversed = reverse(even);
+    static_assert(std::is_same_v<decltype(*reversed.begin()), const int&>);
+    ASSERT_EQ(&*reversed.begin(), &numbers[3]);
+
+    std::vector<Record> records {{"first", {}}, {"second", {}}};
+    auto record_names = transform(records, [](const Record& record) -> const std::string& { return record.name; });
+    static_assert(std::is_same_v<decltype(*record_names.begin()), const std::string&>);
+    ASSERT_EQ(&*record_names.begin(), &records[0].name);
+
+    auto doubled = numbers | transform(mult_2_int);
+    static_assert(std::is_same_v<decltype(*doubled.begin()), int>);
+}
+
+std::vector<int> make_numbers() {
+    return {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+}
+
+TEST(adaptersTestSuite, TemporaryContainerPipelineTest) {
+    auto res = make_numbers() | filter(is_devided_by_twoo_int) | transform(square) | reverse();
+    std::vector<int> ans {100, 64, 36, 16, 4};
+
+    int c = 0;
+    for (auto element: res) {
+        ASSERT_EQ(element, ans[c]);
+        ++c;
+    }
+    ASSERT_EQ(c, 5);
 
+    auto values_ = std::map<int, std::string> {{1, "one"}, {2, "two"}} | values();
+    ASSERT_EQ(*values_.begin(), "one");
+}
+
+TEST(adaptersTestSuite, OwningViewMovesContainerTest) {
+    std::vector<int> batch {1, 2, 3, 4, 5};
+    const int* data = batch.data();
+
+    auto owned = std::move(batch) | drop(1) | take(3);
+    ASSERT_EQ(&*owned.begin(), data + 1);
+    ASSERT_EQ(owned.end() - owned.begin(), 3);
+
+    auto moved = std::move(owned);
+    ASSERT_EQ(&*moved.begin(), data + 1);
+    ASSERT_EQ(std::to_address(moved.end()), data + 4);
+}
+
+TEST(adaptersTestSuite, IteratorSizeTest) {
+    std::vector<int> numbers {0, 2, 3, 4, 5, 6, 8, 10, 12, 14};
+    std::map<int, int> g {{0, 1}, {2, 3}, {3, 0}, {4, 4}};
+
+    auto dropped = numbers | drop(1);
+    auto taken = dropped | take(8);
+    auto filtered = taken | filter(is_devided_by_twoo_int);
+    auto reversed = filtered | reverse();
+    auto transformed = reversed | transform(mult_2_int);
+
+    // Probes make every iterator carry a pointer to its stage's counters.
+#ifndef ADAPTERS_INSTRUMENTATION
+    using VectorIterator = std::vector<int>::const_iterator;
+    using MapIterator = std::map<int, int>::const_iterator;
+
+    ASSERT_EQ(sizeof(dropped.begin()), sizeof(VectorIterator));
+    ASSERT_EQ(sizeof(taken.begin()), sizeof(VectorIterator));
+    ASSERT_EQ(sizeof(filtered.begin()), sizeof(VectorIterator) + sizeof(void*));
+    ASSERT_EQ(sizeof(reversed.begin()), sizeof(VectorIterator) + sizeof(void*));
+    ASSERT_EQ(sizeof(transformed.begin()), sizeof(VectorIterator) + 2 * sizeof(void*));
 
+    auto map_keys = g | filter(is_devided_by_twoo) | transform(mult_2) | keys();
+    ASSERT_EQ(sizeof(map_keys.begin()), sizeof(MapIterator) + 2 * sizeof(void*));
+#endif
 
+    std::vector<int> ans {24, 20, 16, 12, 8, 4};
+    int c = 0;
+    for (auto element: transformed) {
+        ASSERT_EQ(element, ans[c]);
+        ++c;
+    }
+    ASSERT_EQ(c, 6);
+}
+
+struct CopyCountingSquare {
+    CopyCountingSquare(int& copies): copies(copies) {}
+
+    CopyCountingSquare(const CopyCountingSquare& other): copies(other.copies) {
+        ++copies;
+    }
 
+    CopyCountingSquare(CopyCountingSquare&& other) = default;
+
+    int operator()(int x) const {
+        return x * x;
+    }
+
+    int& copies;
+};
+
+TEST(adaptersTestSuite, FunctorIsNotCopiedTest) {
+    std::vector<int> numbers {1, 2, 3, 4, 5};
+    int copies = 0;
+
+    auto res = numbers | transform(CopyCountingSquare(copies)) | filter(is_devided_by_twoo_int);
+    ASSERT_EQ(copies, 0);
+
+    int sum = 0;
+    for (auto it = res.begin(); it != res.end(); it++) {
+        sum += *it;
+    }
+    ASSERT_EQ(sum, 4 + 16);
+    ASSERT_EQ(copies, 0);
+}
+
+TEST(adaptersTestSuite, PushTerminalsTest) {
+    std::vector<int> numbers {0, 2, 3, 4, 5, 6, 8, 10, 12, 14};
+    std::map<int, int> g {{0, 1}, {2, 3}, {3, 0}, {4, 4}, {5, 2}, {6, 5}, {8, 6}, {10, 7}, {12, 8}, {14, 9}};
+    std::list<int> letters {1, 2, 3, 4, 5};
+
+    int sum = numbers | drop(2) | take(7) | filter(is_devided_by_twoo_int) | transform(mult_2_int)
+              | reduce(0, std::plus<>());
+    ASSERT_EQ(sum, 80);
+
+    int keys_sum = g | drop(2) | take(7) | filter(is_devided_by_twoo) | transform(mult_2) | keys()
+                   | reduce(0, std::plus<>());
+    ASSERT_EQ(keys_sum, 80);
+
+    ASSERT_EQ(numbers | filter(is_devided_by_twoo_int) | count(), 8);
+    ASSERT_EQ(letters | drop(3) | count(), 2);
+    ASSERT_EQ(g | values() | take(0) | count(), 0);
+
+    std::vector<int> collected;
+    numbers | reverse() | take(3) | for_each([&collected](int x) { collected.push_back(x); });
+    ASSERT_EQ(collected, (std::vector<int> {14, 12, 10}));
+}
+
+TEST(adaptersTestSuite, PushTakeEarlyExitTest) {
+    std::deque<int> numbers(1000);
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        numbers[i] = static_cast<int>(i);
+    }
+
+    int checks = 0;
+    auto res = numbers | filter([&checks](int x) {
+        ++checks;
+        return x % 3 == 0;
+    }) | take(3);
+
+    ASSERT_EQ(res | reduce(0, std::plus<>()), 0 + 3 + 6);
+    ASSERT_EQ(checks, 7);
+
+    std::vector<int> contiguous_numbers(numbers.begin(), numbers.end());
+    checks = 0;
+    auto batched = contiguous_numbers | filter([&checks](int x) {
+        ++checks;
+        return x % 3 == 0;
+    }) | take(3);
+
+    ASSERT_EQ(batched | reduce(0, std::plus<>()), 0 + 3 + 6);
+    ASSERT_GE(checks, 7);
+    ASSERT_LT(checks, static_cast<int>(contiguous_numbers.size()));
+}
+
+template <typename T>
+void check_compaction_kernels() {
+    std::vector<T> values(1000);
+    std::vector<uint8_t> mask(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<T>(i);
+        mask[i] = (i * 7919 % 13) < 5;
+    }
+
+    std::vector<T> expected(values.size());
+    size_t expected_kept = compact_selected(values.data(), mask.data(), values.size(), expected.data(), SimdLevel::Scalar);
+
+    for (SimdLevel level: {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx2}) {
+        if (level > detect_simd_level()) {
+            continue;
+        }
+        for (size_t n: {0, 1, 3, 8, 31, 1000}) {
+            std::vector<T> out(values.size());
+            size_t kept = compact_selected(values.data(), mask.data(), n, out.data(), level);
+            size_t scalar_kept = compact_selected(values.data(), mask.data(), n, expected.data(), SimdLevel::Scalar);
+            ASSERT_EQ(kept, scalar_kept);
+            for (size_t i = 0; i < kept; ++i) {
+                ASSERT_EQ(out[i], expected[i]);
+            }
+        }
+    }
+    ASSERT_GT(expected_kept, 0);
+}
+
+TEST(adaptersTestSuite, CompactionKernelsTest) {
+    check_compaction_kernels<int>();
+    check_compaction_kernels<float>();
+    check_compaction_kernels<double>();
+    check_compaction_kernels<int64_t>();
+    check_compaction_kernels<char>();
+}
+
+TEST(adaptersTestSuite, BatchedFilterTransformTest) {
+    std::vector<float> numbers(10'000);
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        numbers[i] = static_cast<float>(i % 1000) / 4;
+    }
+
+    auto is_large = [](float x) { return x > 100; };
+    auto scale = [](float x) { return static_cast<double>(x) * 3; };
+
+    double expected = 0;
+    size_t expected_count = 0;
+    for (float x: numbers) {
+        if (is_large(x)) {
+            expected += scale(x);
+            ++expected_count;
+        }
+    }
+
+    for (SimdLevel level: {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx2}) {
+        set_simd_level(level);
+        ASSERT_EQ(numbers | filter(is_large) | transform(scale) | reduce(0.0, std::plus<>()), expected);
+        ASSERT_EQ(numbers | drop(1) | filter(is_large) | count(), expected_count);
+    }
+    set_simd_level(detect_simd_level());
+
+    std::vector<int> integers {0, 2, 3, 4, 5, 6, 8, 10, 12, 14};
+    std::vector<int> collected;
+    integers | filter(is_devided_by_twoo_int) | transform(mult_2_int)
+             | for_each([&collected](int x) { collected.push_back(x); });
+    ASSERT_EQ(collected, (std::vector<int> {0, 4, 8, 12, 16, 20, 24, 28}));
+}
+
+TEST(adaptersTestSuite, ParallelTerminalsTest) {
+    std::vector<int> numbers(200'000);
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        numbers[i] = static_cast<int>(i % 1000);
+    }
+
+    auto page = numbers | drop(1'000) | take(150'000) | transform(square);
+    long long expected = page | reduce(0LL, std::plus<>());
+    ASSERT_EQ(page | par_reduce(0LL, std::plus<>()), expected);
+
+    std::vector<int> sequential;
+    numbers | reverse() | transform(mult_2_int) | for_each([&sequential](int x) { sequential.push_back(x); });
+    ASSERT_EQ(numbers | reverse() | transform(mult_2_int) | par_to_vector(), sequential);
+
+    std::atomic<long long> sum = 0;
+    numbers | drop(1'000) | par_for_each([&sum](int x) { sum += x; });
+    ASSERT_EQ(sum, numbers | drop(1'000) | reduce(0LL, std::plus<>()));
+
+    ASSERT_EQ(numbers | take(0) | par_reduce(7, std::plus<>()), 7);
+}
+
+TEST(adaptersTestSuite, ParallelReduceOrderTest) {
+    std::vector<int> digits(20'000);
+    for (size_t i = 0; i < digits.size(); ++i) {
+        digits[i] = static_cast<int>(i % 10);
+    }
+
+    auto as_string = [](int x) { return std::to_string(x); };
+    std::string expected = digits | transform(as_string) | reduce(std::string(), std::plus<>());
+    ASSERT_EQ(digits | transform(as_string) | par_reduce(std::string(), std::plus<>()), expected);
+
+    auto throwing = [](int x) {
+        if (x == 9) {
+            throw std::runtime_error("bad digit");
+        }
+        return x;
+    };
+    ASSERT_THROW(digits | transform(throwing) | par_reduce(0, std::plus<>()), std::runtime_error);
+}
+
+TEST(adaptersTestSuite, ParallelFilterPipelineTest) {
+    std::vector<int> numbers(100'000);
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        numbers[i] = static_cast<int>(i);
+    }
+
+    // Only the first tenth of the range is expensive to test, so a fixed split would leave one chunk behind.
+    auto is_prime = [](int x) {
+        if (x >= 10'000) {
+            return x % 7 == 0;
+        }
+        if (x < 2) {
+            return false;
+        }
+        for (int d = 2; d * d <= x; ++d) {
+            if (x % d == 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto square = [](int x) { return static_cast<long long>(x) * x; };
+
+    long long expected_sum = numbers | filter(is_prime) | transform(square) | reduce(0LL, std::plus<>());
+    ASSERT_EQ(numbers | filter(is_prime) | transform(square) | par_reduce(0LL, std::plus<>()), expected_sum);
+
+    std::vector<long long> expected;
+    numbers | filter(is_prime) | transform(square) | for_each([&expected](long long x) { expected.push_back(x); });
+    ASSERT_EQ(numbers | filter(is_prime) | transform(square) | par_to_vector(), expected);
+
+    std::atomic<size_t> visited = 0;
+    numbers | filter(is_prime) | par_for_each([&visited](int) { ++visited; });
+    ASSERT_EQ(visited, expected.size());
+
+    std::vector<std::pair<int, std::string>> records;
+    for (int i = 0; i < 10'000; ++i) {
+        records.emplace_back(i, std::to_string(i));
+    }
+    auto kept = records | filter([](const auto& record) { return record.first % 3 == 0; }) | values() | par_to_vector();
+    ASSERT_EQ(kept.size(), 3334);
+    ASSERT_EQ(kept.front(), "0");
+    ASSERT_EQ(kept.back(), "9999");
+}
+
+TEST(adaptersTestSuite, WorkStealingTest) {
+    ThreadPool pool(2);
+    std::atomic<int> arrived = 0;
+    auto meet = [&arrived] {
+        ++arrived;
+        while (arrived < 2) {
+            std::this_thread::yield();
+        }
+    };
+
+    // Both halves wait for each other, so the worker that spawned them can only finish if the other one steals.
+    auto outer = pool.submit([&pool, &meet] {
+        auto first = pool.submit(meet);
+        auto second = pool.submit(meet);
+        pool.wait(first);
+        pool.wait(second);
+    });
+    outer.get();
+
+    auto statistics = pool.statistics();
+    ASSERT_EQ(statistics.size(), 2);
+    size_t steals = 0;
+    size_t chunks = 0;
+    for (const auto& worker: statistics) {
+        steals += worker.steals;
+        chunks += worker.chunks;
+    }
+    ASSERT_GE(steals, 1);
+    ASSERT_EQ(chunks, 3);
+
+    pool.reset_statistics();
+    ASSERT_EQ(pool.statistics()[0].chunks, 0);
+}
+
+TEST(adaptersTestSuite, ViewSizeTest) {
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7};
+    std::list<int> list = {1, 2, 3};
+    std::map<int, std::string> names = {{1, "one"}, {2, "two"}};
+    auto square = [](int x) { return x * x; };
+
+    ASSERT_EQ((numbers | transform(square)).size(), 7);
+    ASSERT_EQ((numbers | take(3)).size(), 3);
+    ASSERT_EQ((numbers | take(100)).size(), 7);
+    ASSERT_EQ((numbers | drop(2)).size(), 5);
+    ASSERT_TRUE((numbers | drop(100)).empty());
+    ASSERT_EQ((numbers | reverse() | drop(1) | take(4)).size(), 4);
+    ASSERT_EQ((list | take(2)).size(), 2);
+    ASSERT_FALSE((list | transform(square)).empty());
+    ASSERT_EQ((names | keys()).size(), 2);
+    ASSERT_EQ((names | values()).size(), 2);
+
+    auto is_even = [](int x) { return x % 2 == 0; };
+    ASSERT_FALSE(IsSized<decltype(numbers | filter(is_even))>);
+    ASSERT_FALSE(IsSized<decltype(numbers | filter(is_even) | take(2))>);
+}
+
+TEST(adaptersTestSuite, ToContainerTest) {
+    std::vector<int> numbers(1000);
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        numbers[i] = static_cast<int>(i);
+    }
+    auto square = [](int x) { return x * x; };
+    auto is_even = [](int x) { return x % 2 == 0; };
+
+    auto squares = numbers | transform(square) | take(10) | to<std::vector<int>>();
+    ASSERT_EQ(squares, std::vector<int>({0, 1, 4, 9, 16, 25, 36, 49, 64, 81}));
+    ASSERT_EQ(squares.capacity(), 10);
+
+    auto evens = numbers | filter(is_even) | to<std::vector<int>>();
+    ASSERT_EQ(evens.size(), 500);
+    ASSERT_EQ(evens.back(), 998);
+
+    std::map<int, std::string> names = {{1, "one"}, {2, "two"}, {3, "three"}};
+    ASSERT_EQ(names | values() | to<std::list<std::string>>(), std::list<std::string>({"one", "two", "three"}));
+    ASSERT_EQ(numbers | transform([](int x) { return x % 3; }) | to<std::set<int>>(), std::set<int>({0, 1, 2}));
+}
+
+TEST(adaptersTestSuite, CollapsedStacksTest) {
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    auto is_even = [](int x) { return x % 2 == 0; };
+    auto square = [](int x) { return x * x; };
+    auto increment = [](int x) { return x + 1; };
+
+    auto taken = numbers | take(7) | take(3) | take(5);
+    static_assert(std::is_same_v<decltype(taken), TakeView<std::vector<int>>>);
+    ASSERT_EQ(taken | to<std::vector<int>>(), std::vector<int>({1, 2, 3}));
+
+    auto dropped = numbers | drop(2) | drop(3);
+    static_assert(std::is_same_v<decltype(dropped), DropView<std::vector<int>>>);
+    ASSERT_EQ(dropped | to<std::vector<int>>(), std::vector<int>({6, 7, 8, 9, 10}));
+    auto uncollapsed = numbers | std::views::drop(2) | std::views::drop(3);
+    ASSERT_EQ(dropped | to<std::vector<int>>(), std::vector<int>(uncollapsed.begin(), uncollapsed.end()));
+
+    auto saturated = numbers | drop(5) | drop(std::numeric_limits<size_t>::max());
+    static_assert(std::is_same_v<decltype(saturated), DropView<std::vector<int>>>);
+    ASSERT_TRUE(saturated.empty());
+    ASSERT_EQ(saturated.begin(), saturated.end());
+    size_t c = 0;
+    for (int element: saturated) {
+        ASSERT_EQ(element, 0);
+        ++c;
+    }
+    ASSERT_EQ(c, 0);
+    auto saturated_uncollapsed =
+            numbers | std::views::drop(5) | std::views::drop(std::numeric_limits<std::ptrdiff_t>::max());
+    ASSERT_EQ(saturated | to<std::vector<int>>(),
+              std::vector<int>(saturated_uncollapsed.begin(), saturated_uncollapsed.end()));
+
+    auto transformed = numbers | transform(square) | transform(increment);
+    static_assert(std::is_same_v<decltype(transformed)::base_type, std::vector<int>>);
+    ASSERT_EQ(transformed | take(3) | to<std::vector<int>>(), std::vector<int>({2, 5, 10}));
+
+    auto unreversed = numbers | reverse() | reverse();
+    static_assert(std::is_same_v<decltype(unreversed), RefView<std::vector<int>>>);
+    ASSERT_EQ(unreversed | to<std::vector<int>>(), numbers);
+
+    auto reversed = numbers | filter(is_even) | reverse() | reverse() | reverse();
+    static_assert(std::is_same_v<decltype(reversed)::base_type, OwningView<FilterView<std::vector<int>, decltype(is_even)>>>);
+    ASSERT_EQ(reversed | to<std::vector<int>>(), std::vector<int>({10, 8, 6, 4, 2}));
+
+    auto named = numbers | filter(is_even) | reverse();
+    auto named_unreversed = named | reverse();
+    static_assert(std::is_same_v<decltype(named_unreversed), RefView<const OwningView<FilterView<std::vector<int>, decltype(is_even)>>>>);
+    ASSERT_EQ(named_unreversed | to<std::vector<int>>(), std::vector<int>({2, 4, 6, 8, 10}));
+
+    auto named_take = numbers | transform(square) | take(4);
+    auto retaken = named_take | take(2);
+    ASSERT_EQ(retaken | to<std::vector<int>>(), std::vector<int>({1, 4}));
+    ASSERT_EQ(named_take | to<std::vector<int>>(), std::vector<int>({1, 4, 9, 16}));
+
+    auto function_style = reverse(numbers);
+    ASSERT_EQ(reverse(function_style) | to<std::vector<int>>(), numbers);
+}
+
+struct Naturals {
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = int;
+        using reference = int;
+
+        const_iterator() = default;
+
+        explicit const_iterator(int value): value_(value) {}
+
+        int operator*() const {
+            return value_;
+        }
+
+        const_iterator& operator++() {
+            ++value_;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++value_;
+            return temp;
+        }
+
+        const_iterator& operator--() {
+            --value_;
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator temp = *this;
+            --value_;
+            return temp;
+        }
+
+        bool operator==(const const_iterator& other) const = default;
+
+    private:
+        int value_ = 0;
+    };
+
+    const_iterator begin() const {
+        return const_iterator(0);
+    }
+
+    std::unreachable_sentinel_t end() const {
+        return std::unreachable_sentinel;
+    }
+};
+
+struct StreamNumbers {
+    using const_iterator = std::istream_iterator<int>;
+
+    const_iterator begin() const {
+        return const_iterator(stream);
+    }
+
+    const_iterator end() const {
+        return const_iterator();
+    }
+
+    std::istream& stream;
+};
+
+TEST(adaptersTestSuite, SentinelTakeTest) {
+    Naturals naturals;
+    auto is_odd = [](int x) { return x % 2 == 1; };
+    auto square = [](int x) { return x * x; };
+
+    ASSERT_EQ(naturals | take(5) | to<std::vector<int>>(), std::vector<int>({0, 1, 2, 3, 4}));
+    ASSERT_EQ(naturals | filter(is_odd) | take(3) | transform(square) | to<std::vector<int>>(),
+              std::vector<int>({1, 9, 25}));
+    ASSERT_EQ(naturals | drop(3) | transform(square) | take(2) | to<std::vector<int>>(), std::vector<int>({9, 16}));
+
+    std::vector<int> pulled;
+    for (int x: naturals | filter(is_odd) | take(4) | reverse()) {
+        pulled.push_back(x);
+    }
+    ASSERT_EQ(pulled, std::vector<int>({7, 5, 3, 1}));
+
+    std::list<int> list = {1, 2, 3, 4, 5};
+    auto taken = list | take(3);
+    static_assert(!IsCommon<decltype(taken)>);
+    static_assert(IsCommon<decltype(std::vector<int>() | take(3))>);
+    ASSERT_EQ(taken | reverse() | to<std::vector<int>>(), std::vector<int>({3, 2, 1}));
+    ASSERT_EQ((list | take(10)).size(), 5);
+
+    std::istringstream input("1 2 3 4 5 6");
+    StreamNumbers numbers {input};
+    ASSERT_EQ(numbers | take(3) | to<std::vector<int>>(), std::vector<int>({1, 2, 3}));
+    // Internal iteration stops right after the last taken element, so nothing more is read from the stream.
+    ASSERT_EQ(numbers | take(2) | to<std::vector<int>>(), std::vector<int>({4, 5}));
+}
+
+TEST(adaptersTestSuite, GeneratorSourcesTest) {
+    auto is_odd = [](int x) { return x % 2 == 1; };
+    auto square = [](int x) { return x * x; };
+
+    ASSERT_EQ(iota(3, 8) | to<std::vector<int>>(), std::vector<int>({3, 4, 5, 6, 7}));
+    ASSERT_EQ(iota(3, 8).size(), 5);
+    ASSERT_TRUE(iota(5, 5).empty());
+    ASSERT_TRUE(iota(8, 3).empty());
+    ASSERT_EQ(iota(8, 3).size(), 0);
+    ASSERT_EQ(iota(8, 3) | count(), 0);
+    ASSERT_EQ(iota(8, 3).begin(), iota(8, 3).end());
+    ASSERT_EQ(iota(0, 10) | filter(is_odd) | transform(square) | reverse() | to<std::vector<int>>(),
+              std::vector<int>({81, 49, 25, 9, 1}));
+    ASSERT_EQ(iota(0) | filter(is_odd) | transform(square) | take(3) | to<std::vector<int>>(),
+              std::vector<int>({1, 9, 25}));
+    ASSERT_EQ(iota(10) | drop(1'000'000) | take(2) | to<std::vector<int>>(), std::vector<int>({1'000'010, 1'000'011}));
+    ASSERT_EQ(iota(1, 100'001) | transform([](int x) { return static_cast<long long>(x); }) | par_reduce(0LL, std::plus<>()),
+              5'000'050'000LL);
+
+    auto words = repeat(std::string("ab"), 3);
+    ASSERT_EQ(words.size(), 3);
+    ASSERT_EQ(words | reduce(std::string(), std::plus<>()), "ababab");
+    ASSERT_EQ(words.begin()[2], "ab");
+    ASSERT_EQ(repeat(7, 4) | drop(1) | count(), 3);
+
+    int next = 1;
+    auto powers = generate([&next] {
+        int current = next;
+        next *= 2;
+        return current;
+    });
+    ASSERT_EQ(powers | take(5) | to<std::vector<int>>(), std::vector<int>({1, 2, 4, 8, 16}));
+    std::vector<int> pulled;
+    for (int x: powers | filter([](int x) { return x > 100; }) | take(2)) {
+        pulled.push_back(x);
+    }
+    ASSERT_EQ(pulled, std::vector<int>({128, 256}));
+}
+
+TEST(adaptersTestSuite, IstreamSourceTest) {
+    std::istringstream input("5 1 4 2 3 x 9");
+    auto small = from_istream<int>(input) | filter([](int x) { return x < 4; }) | to<std::vector<int>>();
+    ASSERT_EQ(small, std::vector<int>({1, 2, 3}));
+
+    std::istringstream words("one two three four");
+    std::vector<std::string> pulled;
+    for (const auto& word: from_istream<std::string>(words) | drop(1) | take(2)) {
+        pulled.push_back(word);
+    }
+    ASSERT_EQ(pulled, std::vector<std::string>({"two", "three"}));
+
+    std::istringstream lengths("aa bbb c");
+    ASSERT_EQ(from_istream<std::string>(lengths) | transform([](const std::string& s) { return s.size(); })
+              | reduce(size_t(0), std::plus<>()), 6);
+}
+
+#ifdef ADAPTERS_MMAP
+TEST(adaptersTestSuite, MappedFileTest) {
+    auto directory = std::filesystem::temp_directory_path();
+    auto lines_path = (directory / "adapters_test_lines.txt").string();
+    auto records_path = (directory / "adapters_test_records.bin").string();
+    auto empty_path = (directory / "adapters_test_empty.txt").string();
+
+    std::ofstream(lines_path) << "first\nsecond line\n\nerror: disk\nlast";
+    {
+        std::ofstream records(records_path, std::ios::binary);
+        for (int64_t i = 0; i < 1000; ++i) {
+            records.write(reinterpret_cast<const char*>(&i), sizeof(i));
+        }
+        records.write("xyz", 3);
+    }
+    std::ofstream(empty_path).close();
+
+    auto lines = mmap_lines(lines_path);
+    ASSERT_EQ(lines | to<std::vector<std::string_view>>(),
+              std::vector<std::string_view>({"first", "second line", "", "error: disk", "last"}));
+    std::vector<std::string> pulled;
+    for (std::string_view line: lines | drop(1) | take(2)) {
+        pulled.emplace_back(line);
+    }
+    ASSERT_EQ(pulled, std::vector<std::string>({"second line", ""}));
+    auto errors = lines | filter([](std::string_view line) { return line.starts_with("error"); })
+                  | transform([](std::string_view line) { return line.size(); });
+    ASSERT_EQ(errors | to<std::vector<size_t>>(), std::vector<size_t>({11}));
+    ASSERT_EQ(mmap_lines(empty_path) | count(), 0);
+
+    auto records = mmap_records<int64_t>(records_path);
+    ASSERT_EQ(records.size(), 1000);
+    auto tail = records | drop(990) | take(3);
+    static_assert(std::contiguous_iterator<decltype(tail.begin())>);
+    ASSERT_EQ(tail | to<std::vector<int64_t>>(), std::vector<int64_t>({990, 991, 992}));
+    ASSERT_EQ(&*tail.begin(), &*records.begin() + 990);
+    ASSERT_EQ(records | filter([](int64_t x) { return x % 100 == 0; }) | count(), 10);
+    ASSERT_EQ(records | par_reduce(int64_t(0), std::plus<>()), 999 * 1000 / 2);
+
+    ASSERT_THROW(mmap_lines((directory / "adapters_test_missing.txt").string()), std::system_error);
+
+    std::filesystem::remove(lines_path);
+    std::filesystem::remove(records_path);
+    std::filesystem::remove(empty_path);
+}
+#endif
+
+TEST(adaptersTestSuite, ChunkTest) {
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+    auto spans = numbers | drop(1) | chunk(4);
+    static_assert(std::is_same_v<decltype(*spans.begin()), std::span<const int>>);
+    ASSERT_EQ(spans.size(), 3);
+    std::vector<std::vector<int>> batches;
+    for (auto batch: spans) {
+        batches.emplace_back(batch.begin(), batch.end());
+    }
+    ASSERT_EQ(batches, std::vector<std::vector<int>>({{2, 3, 4, 5}, {6, 7, 8, 9}, {10}}));
+    ASSERT_EQ((*spans.begin()).data(), numbers.data() + 1);
+
+    auto square = [](int x) { return x * x; };
+    std::vector<std::vector<int>> pushed;
+    numbers | transform(square) | chunk(3) | for_each([&pushed](std::span<const int> batch) {
+        pushed.emplace_back(batch.begin(), batch.end());
+    });
+    ASSERT_EQ(pushed, std::vector<std::vector<int>>({{1, 4, 9}, {16, 25, 36}, {49, 64, 81}, {100}}));
+
+    std::vector<std::vector<int>> pulled;
+    for (auto batch: numbers | filter(is_devided_by_twoo_int) | chunk(2)) {
+        pulled.emplace_back(batch.begin(), batch.end());
+    }
+    ASSERT_EQ(pulled, std::vector<std::vector<int>>({{2, 4}, {6, 8}, {10}}));
+
+    std::list<std::string> words = {"a", "b", "c", "d"};
+    ASSERT_EQ(words | chunk(3) | count(), 2);
+    size_t total_size = 0;
+    iota(0) | chunk(5) | take(2) | for_each([&total_size](std::span<const int> batch) { total_size += batch.size(); });
+    ASSERT_EQ(total_size, 10);
+
+    ASSERT_THROW(chunk(0), std::invalid_argument);
+}
+
+TEST(adaptersTestSuite, AsyncTransformTest) {
+    std::vector<int> numbers(200);
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        numbers[i] = static_cast<int>(i);
+    }
+
+    std::atomic<int> started = 0;
+    auto slow_square = [&started](int x) {
+        ++started;
+        if (x % 7 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return x * x;
+    };
+
+    const int window = 4;
+    int consumed = 0;
+    bool window_respected = true;
+    numbers | async_transform(slow_square, 3, window) | for_each([&](int square) {
+        window_respected = window_respected && started <= consumed + window + 1;
+        ASSERT_EQ(square, consumed * consumed);
+        ++consumed;
+    });
+    ASSERT_EQ(consumed, 200);
+    ASSERT_TRUE(window_respected);
+
+    std::vector<int> pulled;
+    for (int square: numbers | filter(is_devided_by_twoo_int) | async_transform(slow_square, 2, 3) | take(5)) {
+        pulled.push_back(square);
+    }
+    ASSERT_EQ(pulled, std::vector<int>({0, 4, 16, 36, 64}));
+
+    auto lengths = std::vector<std::string>({"a", "bb", "ccc"}) | async_transform([](const std::string& s) {
+        return s.size();
+    });
+    ASSERT_EQ(lengths | to<std::vector<size_t>>(), std::vector<size_t>({1, 2, 3}));
+    ASSERT_EQ(lengths.size(), 3);
+
+    auto throwing = [](int x) {
+        if (x == 50) {
+            throw std::runtime_error("bad element");
+        }
+        return x;
+    };
+    ASSERT_THROW(numbers | async_transform(throwing, 2, 8) | to<std::vector<int>>(), std::runtime_error);
+}
+
+TEST(adaptersTestSuite, AsyncTransformEarlyExitTest) {
+    std::vector<int> numbers(64, 1);
+    std::atomic<int> calls = 0;
+    auto slow = [&calls](int x) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ++calls;
+        return x;
+    };
+
+    ASSERT_EQ(numbers | async_transform(slow, 0, 8) | take(1) | count(), 1);
+    int calls_on_return = calls;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(calls, calls_on_return);
+
+    calls = 0;
+    {
+        auto view = numbers | async_transform(slow, 2, 8);
+        for (int x: view) {
+            ASSERT_EQ(x, 1);
+            break;
+        }
+        view.begin();
+    }
+    calls_on_return = calls;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(calls, calls_on_return);
+    ASSERT_LE(calls_on_return, 17);
+}
+
+TEST(adaptersTestSuite, Cache1Test) {
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    int calls = 0;
+    auto counted_square = [&calls](int x) {
+        ++calls;
+        return x * x;
+    };
+    auto is_even = [](int x) { return x % 2 == 0; };
+
+    auto pull = [](const auto& view) {
+        std::vector<int> result;
+        for (auto it = view.begin(); it != view.end(); ++it) {
+            result.push_back(*it);
+        }
+        return result;
+    };
+
+    ASSERT_EQ(pull(numbers | transform(counted_square) | filter(is_even)), std::vector<int>({4, 16, 36, 64, 100}));
+    ASSERT_EQ(calls, 15);
+
+    calls = 0;
+    ASSERT_EQ(pull(numbers | transform(counted_square) | cache1() | filter(is_even)),
+              std::vector<int>({4, 16, 36, 64, 100}));
+    ASSERT_EQ(calls, 10);
+
+    calls = 0;
+    std::vector<int> reversed;
+    for (int x: numbers | transform(counted_square) | reverse() | cache1() | take(3)) {
+        reversed.push_back(x + x);
+    }
+    ASSERT_EQ(reversed, std::vector<int>({200, 162, 128}));
+    ASSERT_EQ(calls, 3);
+
+    calls = 0;
+    ASSERT_EQ(numbers | transform(counted_square) | cache1() | filter(is_even) | count(), 5);
+    ASSERT_EQ(calls, 10);
+    ASSERT_EQ((numbers | transform(counted_square) | cache1()).size(), 10);
+}
+
+#ifdef ADAPTERS_INSTRUMENTATION
+TEST(adaptersTestSuite, InstrumentationTest) {
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    auto is_even = [](int x) {
+        return x % 2 == 0;
+    };
+    auto square = [](int x) {
+        return x * x;
+    };
+    auto stage = [](const std::vector<StageReport>& reports, const std::string& kind) {
+        return *std::find_if(reports.begin(), reports.end(), [&kind](const StageReport& report) {
+            return report.kind == kind;
+        });
+    };
+
+    reset_instrumentation();
+    int sum = 0;
+    for (int x: numbers | filter(is_even) | transform(square)) {
+        sum += x;
+    }
+    ASSERT_EQ(sum, 220);
+
+    auto reports = instrumentation_report();
+    ASSERT_EQ(reports.size(), 2);
+    StageReport filter_stage = stage(reports, "filter");
+    ASSERT_EQ(filter_stage.calls, 10);
+    ASSERT_EQ(filter_stage.increments, 5);
+    ASSERT_EQ(filter_stage.dereferences, 5);
+    ASSERT_GT(filter_stage.copies, 0);
+    StageReport transform_stage = stage(reports, "transform");
+    ASSERT_EQ(transform_stage.calls, 5);
+    ASSERT_EQ(transform_stage.increments, 5);
+    ASSERT_EQ(transform_stage.decrements, 0);
+    ASSERT_EQ(transform_stage.sampled_calls, 0);
+    ASSERT_EQ(transform_stage.estimated_time.count(), 0);
+
+    reset_instrumentation();
+    ASSERT_EQ(numbers | filter(is_even) | transform(square) | reduce(0, std::plus<>()), 220);
+    reports = instrumentation_report();
+    ASSERT_EQ(stage(reports, "filter").calls, 10);
+    ASSERT_EQ(stage(reports, "filter").increments, 0);
+    ASSERT_EQ(stage(reports, "transform").calls, 5);
+
+    reset_instrumentation();
+    std::vector<int> reversed;
+    for (int x: numbers | reverse() | take(3)) {
+        reversed.push_back(x);
+    }
+    ASSERT_EQ(reversed, std::vector<int>({10, 9, 8}));
+    reports = instrumentation_report();
+    // Three steps, and a seek by three that finds the end of take.
+    ASSERT_EQ(stage(reports, "reverse").increments, 6);
+    ASSERT_EQ(stage(reports, "take").dereferences, 3);
+
+    reset_instrumentation();
+    std::vector<int> tail;
+    for (int x: numbers | transform(square) | drop(7)) {
+        tail.push_back(x);
+    }
+    ASSERT_EQ(tail, std::vector<int>({64, 81, 100}));
+    reports = instrumentation_report();
+    ASSERT_EQ(stage(reports, "transform").increments, 10);
+    ASSERT_EQ(stage(reports, "drop").increments, 3);
+
+    set_instrumentation_sampling(1);
+    reset_instrumentation();
+    for (int x: numbers | filter(is_even) | transform(square)) {
+        sum += x;
+    }
+    set_instrumentation_sampling(0);
+    reports = instrumentation_report();
+    ASSERT_EQ(stage(reports, "transform").sampled_calls, 5);
+    ASSERT_EQ(stage(reports, "filter").sampled_calls, 10);
+
+    std::stringstream table;
+    print_instrumentation_report(table);
+    ASSERT_NE(table.str().find("transform#"), std::string::npos);
+
+    std::stringstream trace;
+    write_chrome_trace(trace);
+    ASSERT_EQ(trace.str().rfind("{\"traceEvents\":[", 0), 0);
+    ASSERT_NE(trace.str().find("\"ph\":\"X\""), std::string::npos);
+    ASSERT_NE(trace.str().find("\"calls\":10"), std::string::npos);
+}
+#else
+TEST(adaptersTestSuite, InstrumentationOffTest) {
+    static_assert(sizeof(KeysView<std::map<int, int>>::iterator) == sizeof(std::map<int, int>::const_iterator));
+    static_assert(sizeof(ReverseView<std::vector<int>>::iterator) == sizeof(std::vector<int>::const_iterator));
+
+    std::vector<int> numbers = {1, 2, 3, 4};
+    reset_instrumentation();
+    ASSERT_EQ(numbers | filter(is_devided_by_twoo_int) | count(), 2);
+    ASSERT_TRUE(instrumentation_report().empty());
+}
+#endif
+
+TEST(adaptersTestSuite, FlatMapTest) {
+    FlatMap<int, std::string> names = {{3, "three"}, {1, "one"}, {2, "two"}, {1, "uno"}};
+    ASSERT_EQ(names.size(), 3);
+    ASSERT_EQ(names.at(1), "one");
+    ASSERT_THROW(names.at(4), std::out_of_range);
+    ASSERT_TRUE(names.contains(2));
+    ASSERT_EQ(names.find(5), names.end());
+    ASSERT_EQ(names.lower_bound(2).key(), 2);
+    ASSERT_EQ(names.upper_bound(2).key(), 3);
+
+    ASSERT_TRUE(names.emplace(5, "five").second);
+    ASSERT_FALSE(names.emplace(5, "cinq").second);
+    names[4] = "four";
+    ASSERT_EQ(names.erase(2), 1);
+    ASSERT_EQ(names.erase(2), 0);
+
+    std::vector<int> keys_result;
+    for (int key: names | keys()) {
+        keys_result.push_back(key);
+    }
+    ASSERT_EQ(keys_result, std::vector<int>({1, 3, 4, 5}));
+    static_assert(std::is_same_v<decltype(names | keys()), SpanView<const int>>);
+    static_assert(std::is_same_v<decltype(values(names)), SpanView<const std::string>>);
+
+    std::vector<std::string> values_result;
+    for (const auto& value: names | values() | reverse()) {
+        values_result.push_back(value);
+    }
+    ASSERT_EQ(values_result, std::vector<std::string>({"five", "four", "three", "one"}));
+
+    std::vector<std::pair<int, std::string>> elements;
+    for (auto [key, value]: names | drop(1) | take(2)) {
+        elements.emplace_back(key, value);
+    }
+    ASSERT_EQ(elements, (std::vector<std::pair<int, std::string>>({{3, "three"}, {4, "four"}})));
+
+    FlatMap<int, int> squares;
+    for (int i = 0; i < 10000; ++i) {
+        squares.emplace(i, i * i);
+    }
+    auto is_even = [](int x) {
+        return x % 2 == 0;
+    };
+    ASSERT_EQ(squares | keys() | filter(is_even) | count(), 5000);
+    int64_t sum_of_squares = int64_t(9999) * 10000 * 19999 / 6;
+    ASSERT_EQ(squares | values() | par_reduce(int64_t(0), std::plus<>()), sum_of_squares);
+    ASSERT_EQ((FlatMap<int, int>({{1, 2}, {3, 4}}) | keys() | to<std::vector<int>>()), std::vector<int>({1, 3}));
+}
+
+TEST(adaptersTestSuite, KeyRangeTest) {
+    std::map<int, int> squares;
+    FlatMap<int, int> flat_squares;
+    for (int i = 0; i < 20; i += 2) {
+        squares[i] = i * i;
+        flat_squares.emplace(i, i * i);
+    }
+
+    ASSERT_EQ(squares | key_range(3, 9) | keys() | to<std::vector<int>>(), std::vector<int>({4, 6, 8}));
+    ASSERT_EQ(squares | key_range(4, 8) | values() | to<std::vector<int>>(), std::vector<int>({16, 36}));
+    ASSERT_EQ(squares | key_range(9, 3) | count(), 0);
+    ASSERT_EQ(squares | keys_from(15) | keys() | to<std::vector<int>>(), std::vector<int>({16, 18}));
+    ASSERT_EQ(squares | key_range(0, 7) | reverse() | keys() | to<std::vector<int>>(), std::vector<int>({6, 4, 2, 0}));
+    ASSERT_EQ(flat_squares | key_range(3, 9) | keys() | to<std::vector<int>>(), std::vector<int>({4, 6, 8}));
+    ASSERT_EQ((flat_squares | key_range(3, 19)).size(), 8);
+
+    auto range = squares | key_range(10, 14);
+    squares[11] = 121;
+    squares.erase(10);
+    ASSERT_EQ(range | keys() | to<std::vector<int>>(), std::vector<int>({11, 12}));
+
+    auto half = [](const std::pair<const int, int>& element) {
+        return element.second / 2;
+    };
+    ASSERT_EQ(squares | key_range(12, 17) | transform(half) | to<std::vector<int>>(), std::vector<int>({72, 98, 128}));
+
+    std::set<std::string> words = {"apple", "banana", "cherry", "date"};
+    std::vector<std::string> middle;
+    for (const auto& word: words | key_range(std::string("b"), std::string("d"))) {
+        middle.push_back(word);
+    }
+    ASSERT_EQ(middle, std::vector<std::string>({"banana", "cherry"}));
+
+    auto below_seven = [](int key) {
+        return key < 7;
+    };
+    ASSERT_EQ(squares | take_while_key(below_seven) | keys() | to<std::vector<int>>(), std::vector<int>({0, 2, 4, 6}));
+    ASSERT_EQ(squares | take_while_key(below_seven) | reverse() | values() | to<std::vector<int>>(),
+              std::vector<int>({36, 16, 4, 0}));
+    ASSERT_EQ(flat_squares | take_while_key(below_seven) | keys() | to<std::vector<int>>(),
+              std::vector<int>({0, 2, 4, 6}));
+    ASSERT_EQ((flat_squares | take_while_key(below_seven)).size(), 4);
+    ASSERT_EQ((flat_squares | take_while_key(below_seven)).end() - (flat_squares | take_while_key(below_seven)).begin(),
+              4);
+    ASSERT_EQ(std::set<int>({1, 3, 5, 8, 9}) | take_while_key(below_seven) | count(), 3);
+
+    std::map<int, int> temporary_source = {{1, 1}, {2, 4}, {3, 9}};
+    ASSERT_EQ(std::move(temporary_source) | key_range(2, 4) | values() | to<std::vector<int>>(), std::vector<int>({4, 9}));
+
+    ASSERT_EQ(range | count(), 2);
+    squares[13] = 169;
+    range.refresh();
+    ASSERT_EQ(range | keys() | to<std::vector<int>>(), std::vector<int>({11, 12, 13}));
+
+    const int elements_count = 1 << 12;
+    size_t comparisons = 0;
+    auto counting_less = [&comparisons](int lhs, int rhs) {
+        ++comparisons;
+        return lhs < rhs;
+    };
+    std::map<int, int, decltype(counting_less)> counted(counting_less);
+    FlatMap<int, int> flat_counted;
+    for (int i = 0; i < elements_count; ++i) {
+        counted.emplace(i, i);
+        flat_counted.emplace(i, i);
+    }
+    auto always = [](const auto&) {
+        return true;
+    };
+    comparisons = 0;
+    size_t visited = 0;
+    for (const auto& element: counted | key_range(0, elements_count) | filter(always)) {
+        visited += element.first == static_cast<int>(visited);
+    }
+    ASSERT_EQ(visited, elements_count);
+    ASSERT_LT(comparisons, 100);
+
+    size_t predicate_calls = 0;
+    auto counting_below = [&predicate_calls](int key) {
+        ++predicate_calls;
+        return key < elements_count;
+    };
+    visited = 0;
+    for (const auto& element: flat_counted | take_while_key(counting_below) | filter(always)) {
+        visited += element.first == static_cast<int>(visited);
+    }
+    ASSERT_EQ(visited, elements_count);
+    ASSERT_LT(predicate_calls, 100);
+}
+
+TEST(adaptersTestSuite, OrderStatisticTreeTest) {
+    IndexedSet<int> numbers;
+    std::set<int> expected;
+    for (int i = 0; i < 2000; ++i) {
+        int value = (i * 7919) % 3001;
+        ASSERT_EQ(numbers.insert(value).second, expected.insert(value).second);
+    }
+    ASSERT_FALSE(numbers.insert(7919 % 3001).second);
+    for (int i = 0; i < 3001; i += 3) {
+        ASSERT_EQ(numbers.erase(i), expected.erase(i));
+    }
+    ASSERT_EQ(numbers.size(), expected.size());
+    ASSERT_TRUE(std::equal(numbers.begin(), numbers.end(), expected.begin(), expected.end()));
+
+    std::vector<int> sorted(expected.begin(), expected.end());
+    for (size_t i = 0; i < sorted.size(); i += 97) {
+        ASSERT_EQ(*numbers.nth(i), sorted[i]);
+        ASSERT_EQ(numbers.index_of(numbers.find(sorted[i])), i);
+        ASSERT_EQ(numbers.find(sorted[i]) - numbers.begin(), i);
+        ASSERT_EQ(*(numbers.end() - static_cast<std::ptrdiff_t>(sorted.size() - i)), sorted[i]);
+    }
+    ASSERT_EQ(numbers.nth(sorted.size()), numbers.end());
+    ASSERT_EQ(*std::prev(numbers.end()), sorted.back());
+
+    static_assert(!TakeView<IndexedSet<int>>::is_counted);
+    std::vector<int> page(sorted.begin() + 1000, sorted.begin() + 1010);
+    ASSERT_EQ(numbers | drop(1000) | take(10) | to<std::vector<int>>(), page);
+    ASSERT_EQ((numbers | drop(1000) | take(10)).end() - (numbers | drop(1000) | take(10)).begin(), 10);
+    ASSERT_EQ(numbers | drop(sorted.size() - 2) | take(10) | count(), 2);
+    ASSERT_EQ(numbers | drop(1000) | take(3) | reverse() | to<std::vector<int>>(),
+              std::vector<int>({sorted[1002], sorted[1001], sorted[1000]}));
+
+    IndexedSet<int> copy = numbers;
+    copy.erase(copy.begin());
+    ASSERT_EQ(copy.size() + 1, numbers.size());
+    ASSERT_EQ(*copy.nth(0), sorted[1]);
+
+    auto middle = copy.nth(500);
+    IndexedSet<int> moved = std::move(copy);
+    ASSERT_EQ(*middle, sorted[501]);
+    ASSERT_EQ(moved.end() - middle, static_cast<std::ptrdiff_t>(moved.size() - 500));
+    ASSERT_EQ(*(middle + 10), sorted[511]);
+    ASSERT_EQ(std::next(moved.nth(moved.size() - 1)), moved.end());
+    ASSERT_EQ(*std::prev(moved.end()), sorted.back());
+    ASSERT_EQ(std::distance(middle, moved.end()), static_cast<std::ptrdiff_t>(moved.size() - 500));
+    copy = std::move(moved);
+    ASSERT_EQ(*(middle - 500), sorted[1]);
+    ASSERT_EQ(std::prev(copy.end()) - middle, static_cast<std::ptrdiff_t>(copy.size() - 501));
+    ASSERT_TRUE(moved.empty());
+    moved.insert(5);
+    ASSERT_EQ(moved | to<std::vector<int>>(), std::vector<int>({5}));
+
+    IndexedMap<int, std::string> names = {{2, "two"}, {1, "one"}, {3, "three"}};
+    names[4] = "four";
+    names[1] = "uno";
+    ASSERT_EQ(names.at(1), "uno");
+    ASSERT_THROW(names.at(5), std::out_of_range);
+    ASSERT_EQ(names | drop(1) | take(2) | values() | to<std::vector<std::string>>(),
+              std::vector<std::string>({"two", "three"}));
+    ASSERT_EQ(names | key_range(2, 4) | keys() | to<std::vector<int>>(), std::vector<int>({2, 3}));
+
+    auto three = names.find(3);
+    IndexedMap<int, std::string> moved_names(std::move(names));
+    ASSERT_EQ(three->second, "three");
+    ASSERT_EQ(std::next(three)->second, "four");
+    ASSERT_EQ(std::next(three, 2), moved_names.end());
+    ASSERT_EQ(three - moved_names.begin(), 2);
+}
+
+struct ErasedPipelineHolder {
+    AnyView<int> numbers;
+};
+
+TEST(adaptersTestSuite, AnyViewTest) {
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    auto is_even = [](int x) {
+        return x % 2 == 0;
+    };
+    auto square = [](int x) {
+        return x * x;
+    };
+
+    ErasedPipelineHolder holder {numbers | filter(is_even) | transform(square)};
+    ASSERT_EQ(holder.numbers | to<std::vector<int>>(), std::vector<int>({4, 16, 36, 64, 100}));
+#ifndef ADAPTERS_INSTRUMENTATION
+    ASSERT_TRUE(holder.numbers.is_inline());
+    ASSERT_TRUE(holder.numbers.begin().is_inline());
+#endif
+
+    std::vector<int> pulled;
+    for (int x: holder.numbers) {
+        pulled.push_back(x);
+    }
+    ASSERT_EQ(pulled, std::vector<int>({4, 16, 36, 64, 100}));
+    ASSERT_EQ(holder.numbers | filter([](int x) { return x > 20; }) | count(), 3);
+    ASSERT_EQ(holder.numbers | take(2) | reduce(0, std::plus<>()), 20);
+
+    auto it = holder.numbers.begin();
+    std::array<int, 3> batch {};
+    ASSERT_EQ(it.next_n(batch), 3);
+    ASSERT_EQ(batch, (std::array<int, 3>({4, 16, 36})));
+    ASSERT_EQ(*it, 64);
+    ASSERT_EQ(it.next_n(batch), 2);
+    ASSERT_EQ(it.next_n(batch), 0);
+    ASSERT_TRUE(it == std::default_sentinel);
+
+    AnyView copy = holder.numbers;
+    holder.numbers = numbers | drop(8);
+    ASSERT_EQ(holder.numbers | to<std::vector<int>>(), std::vector<int>({9, 10}));
+    ASSERT_EQ(copy | count(), 5);
+
+    AnyView deduced = numbers | transform([](int x) { return x * 0.5; });
+    static_assert(std::is_same_v<decltype(deduced), AnyView<double>>);
+    ASSERT_EQ(deduced | take(2) | to<std::vector<double>>(), std::vector<double>({0.5, 1.0}));
+
+    AnyView<int> owning = std::vector<int>({7, 8, 9}) | reverse();
+    ASSERT_EQ(owning | to<std::vector<int>>(), std::vector<int>({9, 8, 7}));
+    AnyView<int> moved = std::move(owning);
+    ASSERT_EQ(moved | count(), 3);
+    ASSERT_EQ(owning | count(), 0);
+
+    std::array<int, 64> weights {};
+    weights.fill(2);
+    AnyView<int> large = numbers | transform([weights](int x) { return x * weights[x % 64]; });
+    ASSERT_FALSE(large.is_inline());
+    ASSERT_EQ(large | reduce(0, std::plus<>()), 110);
+
+    std::stringstream stream("1 2 3");
+    AnyView<long> from_stream = from_istream<int>(stream);
+    ASSERT_EQ(from_stream | to<std::vector<long>>(), std::vector<long>({1, 2, 3}));
+}
+
+template <typename Container>
+concept CanResume = requires(Container& container) {
+    container | incremental();
+};
+
+TEST(adaptersTestSuite, IncrementalCursorTest) {
+    std::vector<int> numbers = {1, 2, 3, 4};
+    numbers.shrink_to_fit();
+    auto is_even = [](int x) {
+        return x % 2 == 0;
+    };
+    auto square = [](int x) {
+        return x * x;
+    };
+
+    auto cursor = numbers | filter(is_even) | transform(square) | incremental();
+    std::vector<int> result;
+    auto collect = [&result](int x) {
+        result.push_back(x);
+    };
+    ASSERT_EQ(cursor.pending_source_elements(), 4);
+    ASSERT_EQ(cursor.poll(collect), 2);
+    ASSERT_EQ(result, std::vector<int>({4, 16}));
+    ASSERT_EQ(cursor.position(), 4);
+    ASSERT_EQ(cursor.poll(collect), 0);
+
+    const int* storage = numbers.data();
+    for (int i = 5; i <= 100; ++i) {
+        numbers.push_back(i);
+    }
+    ASSERT_NE(numbers.data(), storage);
+    ASSERT_EQ(cursor.pending_source_elements(), 96);
+    ASSERT_EQ(cursor.poll(collect), 48);
+    ASSERT_EQ(result.size(), 50);
+    ASSERT_EQ(result[2], 36);
+    ASSERT_EQ(result.back(), 10000);
+    ASSERT_EQ(cursor.pending_source_elements(), 0);
+
+    std::deque<std::pair<int, int>> events;
+    auto event_cursor = events | values() | incremental();
+    int total = 0;
+    auto add = [&total](int x) {
+        total += x;
+    };
+    ASSERT_EQ(event_cursor.poll(add), 0);
+    for (int i = 0; i < 1000; ++i) {
+        events.emplace_back(i, 1);
+        if (i % 100 == 99) {
+            ASSERT_EQ(event_cursor.poll(add), 100);
+        }
+    }
+    ASSERT_EQ(total, 1000);
+
+    std::vector<int> raw;
+    auto raw_cursor = raw | incremental();
+    raw.push_back(7);
+    ASSERT_EQ(raw_cursor.poll(add), 1);
+    ASSERT_EQ(total, 1007);
+
+    static_assert(CanResume<std::vector<int>>);
+    static_assert(CanResume<decltype(numbers | filter(is_even) | transform(square))>);
+    static_assert(CanResume<decltype(events | keys() | cache1())>);
+    static_assert(!CanResume<decltype(numbers | take(2))>);
+    static_assert(!CanResume<decltype(numbers | drop(1))>);
+    static_assert(!CanResume<decltype(numbers | reverse())>);
+    static_assert(!CanResume<decltype(numbers | reverse() | filter(is_even))>);
+    static_assert(!CanResume<decltype(numbers | drop(1) | transform(square))>);
+    static_assert(!CanResume<std::list<int>>);
+    static_assert(!CanResume<std::set<int>>);
+    static_assert(!CanResume<const std::vector<int>>);
+    static_assert(!CanResume<decltype(std::as_const(numbers) | filter(is_even))>);
+    static_assert(!CanResume<decltype(std::as_const(events) | values() | transform(square))>);
+}